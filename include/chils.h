@@ -47,7 +47,8 @@ extern "C"
      *
      * @returns The ID of the new vertex. This will always be
      * one larger than the previous time the function was
-     * called, starting with 0.
+     * called, starting with 0. Returns -1 while a background
+     * run is active, see chils_wait.
      */
     int chils_add_vertex(void *solver, long long weight);
 
@@ -58,7 +59,8 @@ extern "C"
      *
      * @attention It is not required that both u and v have
      * already been added to the graph at this point. That
-     * requirement only applies when the heuristic starts.
+     * requirement only applies when the heuristic starts. The
+     * edge is ignored while a background run is active.
      *
      * @param solver pointer to the solver object.
      * @param u the first endpoint of the edge.
@@ -66,12 +68,37 @@ extern "C"
      */
     void chils_add_edge(void *solver, int u, int v);
 
+    /**
+     * @brief Add count new vertices at once, see chils_add_vertex.
+     *
+     * @param solver pointer to the solver object.
+     * @param count the number of new vertices.
+     * @param weights array of size count with the new weights.
+     *
+     * @returns The ID of the first new vertex, the rest follow in order,
+     * or -1 while a background run is active.
+     */
+    int chils_add_vertices(void *solver, int count, const long long *weights);
+
+    /**
+     * @brief Add count edges at once, edge i is {u[i], v[i]}. See
+     * chils_add_edge. The graph is built in parallel when the
+     * heuristic starts, and may have more than 2^31 edges.
+     *
+     * @param solver pointer to the solver object.
+     * @param count the number of edges.
+     * @param u array of size count with the first endpoints.
+     * @param v array of size count with the second endpoints.
+     */
+    void chils_add_edges(void *solver, long long count, const int *u, const int *v);
+
     /**
      * @brief Set the input graph for the heuristic on the compressed
      * sparse row (CSR) format. The number of vertices can be at most
      * 2^31, but the number of edges may exceed this limit.
      *
-     * @attention This function makes a copy of the graph.
+     * @attention This function makes a copy of the graph. A graph set
+     * earlier is replaced, together with its solutions and pending updates.
      *
      * @example A cycle with four vertices, the input could look like
      * this: n = 4, xadj = {0,2,4,6,8}, adjncy = {1,2,0,3,0,3,1,2}.
@@ -87,15 +114,125 @@ extern "C"
      */
     void chils_set_graph(void *solver, int n, const long long *xadj, const int *adjncy, const long long *weights);
 
+    /**
+     * @brief Same as chils_set_graph, but the heuristic uses the
+     * given arrays directly instead of making a copy.
+     *
+     * @attention The arrays must stay valid and unchanged until
+     * chils_release is called, and are never freed or written to by
+     * the heuristic. The neighborhoods must be sorted, as for
+     * chils_set_graph.
+     *
+     * @param solver pointer to the solver object.
+     * @param n the number of vertices in the graph.
+     * @param xadj array of size n + 1, see chils_set_graph.
+     * @param adjncy array of size xadj[n], see chils_set_graph.
+     * @param weights array of size n holding the vertex weights.
+     * @param validate 1 to check the graph (in parallel) before the
+     * first run, 0 to skip the check for graphs known to be valid.
+     */
+    void chils_set_graph_borrowed(void *solver, int n, const long long *xadj, const int *adjncy,
+                                  const long long *weights, int validate);
+
+    /**
+     * @brief Same as chils_set_graph_borrowed, but with 32-bit
+     * neighborhood pointers, so the graph has less than 2^31 edges.
+     * Only xadj is copied, adjncy and weights are borrowed.
+     */
+    void chils_set_graph_borrowed32(void *solver, int n, const int *xadj, const int *adjncy,
+                                    const long long *weights, int validate);
+
+    /**
+     * @brief Set the conflict graph of n axis-aligned boxes, such as
+     * label candidates or time intervals. Two boxes conflict if their
+     * interiors intersect, so boxes that only touch do not. The
+     * neighborhoods are found in parallel from a grid index and stored
+     * as a regular CSR graph, so the application does not build an
+     * edge list, but memory still grows with the number of conflicts.
+     *
+     * @param solver pointer to the solver object.
+     * @param n the number of boxes, one vertex per box.
+     * @param dimensions the number of dimensions d, 1 for intervals.
+     * @param lo array of size n * d, box i starts at lo[i * d + k] in
+     * dimension k.
+     * @param hi array of size n * d, box i ends at hi[i * d + k].
+     * @param weights array of size n holding the vertex weights.
+     */
+    void chils_set_boxes(void *solver, int n, int dimensions, const double *lo, const double *hi,
+                         const long long *weights);
+
+    /**
+     * @brief Insert the edge {u,v} into the current graph. Changes
+     * are collected and applied at the start of the next run, which
+     * then continues from the current solutions. Only the vertices
+     * near the changes are repaired, so re-solving after a small
+     * change is much faster than starting over.
+     *
+     * @attention Can be used after the graph is constructed or set,
+     * but not while a background run is active. Borrowed graphs are
+     * never written to. A batch with edge changes rebuilds the graph,
+     * a batch with only weight changes and new vertices copies just
+     * the weights.
+     *
+     * @param solver pointer to the solver object.
+     * @param u the first endpoint of the edge.
+     * @param v the second endpoint of the edge.
+     */
+    void chils_update_insert_edge(void *solver, int u, int v);
+
+    /**
+     * @brief Delete the edge {u,v} from the current graph, see
+     * chils_update_insert_edge. Deleting a missing edge does nothing.
+     */
+    void chils_update_delete_edge(void *solver, int u, int v);
+
+    /**
+     * @brief Change the weight of vertex u in the current graph, see
+     * chils_update_insert_edge.
+     */
+    void chils_update_vertex_weight(void *solver, int u, long long weight);
+
+    /**
+     * @brief Add a new vertex to the current graph, see
+     * chils_update_insert_edge.
+     *
+     * @returns The ID of the new vertex, or -1 on failure.
+     */
+    int chils_update_add_vertex(void *solver, long long weight);
+
+    /**
+     * @brief Start the next run from the given solution. Vertices in
+     * conflict are resolved by keeping the heavier endpoint of each
+     * edge, and the result is then extended greedily, so the input
+     * does not need to be a valid independent set.
+     *
+     * @attention Takes effect at the start of the next run. Several
+     * solutions can be given, one for each slot of the solution pool
+     * of chils_run_full. chils_run_local_search_only uses slot 0.
+     *
+     * @param solver pointer to the solver object.
+     * @param slot index in the solution pool, or -1 for all solutions.
+     * @param configuration array with one entry per vertex, nonzero
+     * for the vertices in the solution.
+     */
+    void chils_set_initial_solution(void *solver, int slot, const int *configuration);
+
+    /**
+     * @brief Same as chils_set_initial_solution, but the solution is
+     * given as a list of size vertices.
+     */
+    void chils_set_initial_independent_set(void *solver, int slot, int size, const int *vertices);
+
     /**
      * @brief Run the heuristic for a certain number of seconds.
      *
      * @attention The alternating time between full graph and the
      * d-core is 10 seconds. For very short time limits, use the
-     * local_search_only function instead. Also, repeated calls
-     * to this function ignore the new values for n_solutions and
-     * seed. It simply continues for time_limit seconds starting
-     * from where the last call ended.
+     * local_search_only function instead. Repeated calls continue
+     * for time_limit seconds starting from where the last call
+     * ended, and ignore the new seed. If n_solutions changed, the
+     * pool is resized first. Shrinking keeps the best solutions,
+     * and new solutions start as copies of the current best ones.
      *
      * @param solver pointer to the solver object.
      * @param time_limit time limit in seconds.
@@ -104,6 +241,242 @@ extern "C"
      */
     void chils_run_full(void *solver, double time_limit, int n_solutions, unsigned int seed);
 
+    /**
+     * @brief Limit each run by work units instead of time. A work unit
+     * is roughly one edge or queue entry visited by the local search,
+     * and the CHILS intervals are also measured in work units. The
+     * result is then the same for any number of threads, as long as
+     * the work limit is reached before the time limit.
+     *
+     * @param solver pointer to the solver object.
+     * @param work_limit max work units per run, 0 to disable.
+     * @param step_work work units per solution in each CHILS interval,
+     * 0 for the default (2^28).
+     */
+    void chils_set_work_limit(void *solver, long long work_limit, long long step_work);
+
+    /**
+     * @brief Count graph construction, validation and setup as part of
+     * the time limit, so a run returns within a few milliseconds of
+     * time_limit seconds after the call. By default the time limit
+     * starts after setup.
+     *
+     * @param solver pointer to the solver object.
+     * @param enabled 1 to include setup in the time limit, 0 otherwise.
+     */
+    void chils_set_total_time(void *solver, int enabled);
+
+    /**
+     * @brief Start chils_run_full from one solution built by all
+     * threads, favoring vertices with a high weight to degree ratio.
+     * It is reported, and stored as the best solution, before the
+     * rest of the pool is built. The other solutions start as
+     * copies of it, each perturbed differently. Meant for large
+     * graphs and short time limits, where building the pool one
+     * solution per thread takes most of the time.
+     *
+     * @param solver pointer to the solver object.
+     * @param enabled 1 to use the fast start, 0 otherwise.
+     */
+    void chils_set_fast_start(void *solver, int enabled);
+
+    /**
+     * @brief Let each thread of chils_run_full run count of the
+     * searches on the full graph together, one perturbation of each
+     * in turn, so the memory loads of one overlap with the work of
+     * the others. Each search still gets the same time, so a phase
+     * with more solutions than threads takes as long as before. Meant
+     * for large graphs with more solutions than threads.
+     *
+     * @param solver pointer to the solver object.
+     * @param count searches per thread, from 1 (the default) to 8.
+     */
+    void chils_set_searches_per_thread(void *solver, int count);
+
+    /**
+     * @brief Track the solution per clique instead of per vertex,
+     * using a greedy partition of the edges into cliques. Adding a
+     * vertex then costs one step per clique it belongs to instead of
+     * one per neighbor, and adjacency tests become clique membership
+     * tests. Meant for dense graphs made of large cliques, such as
+     * map labeling and scheduling instances. The partition is built
+     * at the start of the next run, and not used if it does not have
+     * substantially fewer memberships than the graph has edges.
+     *
+     * @param solver pointer to the solver object.
+     * @param enabled 1 to use the clique partition, 0 otherwise.
+     */
+    void chils_set_clique_partition(void *solver, int enabled);
+
+    /**
+     * @brief Handle up to 64 vertices with at least min_degree
+     * neighbors as hubs. Their contribution to the neighbors is
+     * computed when read instead of updated on every change, so
+     * adding or removing a hub no longer walks its neighborhood, and
+     * removing one queues a window of its neighbors instead of all of
+     * them. Meant for graphs with a few vertices of very high degree.
+     * Not used together with the clique partition.
+     *
+     * @attention Can not be changed while a background run is active.
+     *
+     * @param solver pointer to the solver object.
+     * @param min_degree the smallest degree of a hub, 0 to disable.
+     */
+    void chils_set_hub_degree(void *solver, int min_degree);
+
+    /**
+     * @brief Store the weight of each neighbor next to it in a copy
+     * of the adjacency, so the searches filter neighbors by weight
+     * without a random load per neighbor. Uses 8 more bytes per edge,
+     * and is not used if a weight does not fit in 32 bits.
+     *
+     * @param solver pointer to the solver object.
+     * @param enabled 1 to use the interleaved adjacency, 0 otherwise.
+     */
+    void chils_set_interleaved_adjacency(void *solver, int enabled);
+
+    /**
+     * @brief Stop a run once the best solution is within a relative
+     * gap of the upper bound, that is when the weight is at least
+     * (1 - gap) times the bound. The bound comes from a weighted
+     * clique cover, computed by a helper thread next to the search.
+     * The helper can outlive a short run, so the bound may only be
+     * available to later runs. Local search only runs compute the
+     * bound at the start, and only with a gap tolerance set. By
+     * default a run only stops early on solutions proven optimal.
+     *
+     * @param solver pointer to the solver object.
+     * @param gap relative gap, for example 0.01 for 1%.
+     */
+    void chils_set_gap_tolerance(void *solver, double gap);
+
+    /**
+     * @brief Get the upper bound on the solution weight, once a run
+     * has computed it, see chils_set_gap_tolerance. The gap of the best
+     * solution is (bound - weight) / bound.
+     *
+     * @param solver pointer to the solver object.
+     *
+     * @return The upper bound, or -1 if it is not computed yet.
+     */
+    long long chils_get_upper_bound(void *solver);
+
+    /**
+     * @brief Stop a run once the best solution weighs at least weight,
+     * for example the previous solution plus a small improvement.
+     * Combined with the gap tolerance, whichever is reached first.
+     *
+     * @param solver pointer to the solver object.
+     * @param weight target weight, 0 or less to disable.
+     */
+    void chils_set_target_weight(void *solver, long long weight);
+
+    /**
+     * @brief Stop a run once the best solution has not improved for
+     * a number of seconds or iterations, whichever comes first.
+     * Iterations are CHILS iterations in chils_run_full, and local
+     * search iterations in chils_run_local_search_only.
+     *
+     * @param solver pointer to the solver object.
+     * @param seconds seconds without improvement, 0 or less to disable.
+     * @param iterations iterations without improvement, 0 or less to disable.
+     */
+    void chils_set_stagnation(void *solver, double seconds, long long iterations);
+
+    /**
+     * @brief Get when the last run reached its target, from the target
+     * weight or the gap tolerance. The time is measured like the time
+     * of the best solution, see chils_solution_get_time.
+     *
+     * @param solver pointer to the solver object.
+     *
+     * @return Seconds until the target was reached, or -1.0 if it was not.
+     */
+    double chils_get_time_to_target(void *solver);
+
+    /**
+     * @brief Statistics on how late runs stopped after their deadline.
+     * Only runs that reached the time limit are counted.
+     *
+     * @param solver pointer to the solver object.
+     * @param last set to the overshoot of the last such run, in seconds (can be NULL).
+     * @param max set to the largest overshoot in seconds (can be NULL).
+     * @param mean set to the average overshoot in seconds (can be NULL).
+     *
+     * @returns The number of runs that reached the time limit.
+     */
+    long long chils_get_overshoot(void *solver, double *last, double *max, double *mean);
+
+    /**
+     * @brief Enable recursive CHILS on the D-core. When the D-core
+     * has more than min_core vertices, the core phase runs CHILS on
+     * the D-core itself, with its own solution pool, instead of
+     * plain local search. This repeats for up to max_depth levels.
+     *
+     * @attention Must be called before chils_run_full to take effect
+     * on the first call. The default is max_depth = 0 (disabled).
+     *
+     * @param solver pointer to the solver object.
+     * @param max_depth max number of nested CHILS levels.
+     * @param min_core smallest D-core that triggers a nested level.
+     */
+    void chils_set_recursion(void *solver, int max_depth, int min_core);
+
+    /**
+     * @brief Let CHILS adapt the time spent on the full graph and on
+     * the D-core, per solution, based on how recently each solution
+     * improved. Slices start short and grow while gains continue.
+     *
+     * @param solver pointer to the solver object.
+     * @param enabled 1 to enable, 0 to use the fixed 10 second interval.
+     */
+    void chils_set_adaptive(void *solver, int enabled);
+
+    /**
+     * @brief Periodically store the state of CHILS to a file while
+     * chils_run_full is running. The file is replaced atomically, so
+     * a crash during a write leaves the previous checkpoint intact.
+     *
+     * @param solver pointer to the solver object.
+     * @param path file to store the checkpoints in, NULL to disable.
+     * @param interval minimum number of seconds between checkpoints.
+     */
+    void chils_set_checkpoint(void *solver, const char *path, double interval);
+
+    /**
+     * @brief Restore CHILS from a checkpoint made for the same graph.
+     * The next call to chils_run_full continues from the stored
+     * solutions, with the stored number of solutions and seeds.
+     *
+     * @attention The graph must be constructed or set before this
+     * call. Checkpoints are only portable between identical builds.
+     *
+     * @param solver pointer to the solver object.
+     * @param path the checkpoint file.
+     *
+     * @return 1 if the checkpoint was restored, 0 otherwise.
+     */
+    int chils_resume(void *solver, const char *path);
+
+    /**
+     * @brief Share the solution pool of chils_run_full with other
+     * processes calling the same function on the same graph. Rank 0
+     * coordinates, and every process must use the same address, size,
+     * n_solutions and time limit.
+     *
+     * @attention Blocks until all processes are connected. Not
+     * available on Windows.
+     *
+     * @param solver pointer to the solver object.
+     * @param address unix:/path/to/socket or tcp:host:port, where
+     * rank 0 listens.
+     * @param rank the rank of this process, from 0 to size - 1.
+     * @param size the number of processes.
+     *
+     * @return 1 if all processes are connected, 0 otherwise.
+     */
+    int chils_set_distributed(void *solver, const char *address, int rank, int size);
+
     /**
      * @brief Run the heuristic using only the baseline local search.
      *
@@ -117,6 +490,109 @@ extern "C"
      */
     void chils_run_local_search_only(void *solver, double time_limit, unsigned int seed);
 
+    /**
+     * @brief Solve many independent graphs using the baseline local
+     * search, without creating a solver for each. The instances are
+     * spread over the OpenMP threads, and each thread reuses its
+     * search memory between instances.
+     *
+     * @attention The graphs are on the CSR format described for
+     * chils_set_graph and are not validated. Each instance stops at
+     * its time or iteration limit, whichever comes first. Instance i
+     * uses the seed seed + i, so the result of an instance with an
+     * iteration limit does not depend on the number of threads.
+     *
+     * @param count the number of instances.
+     * @param n array with the number of vertices of each instance.
+     * @param xadj array of neighborhood pointers, one per instance.
+     * @param adjncy array of neighborhood lists, one per instance.
+     * @param weights array of vertex weights, one per instance.
+     * @param time_limit time limit in seconds for each instance.
+     * @param iteration_limit iteration limit for each instance, or NULL
+     * for no iteration limit.
+     * @param seed seed for the random number generator.
+     * @param solutions array of count arrays of size n[i], set to 1 for
+     * the vertices in the independent set and 0 otherwise.
+     * @param solution_weights array of size count, set to the weight of
+     * each solution (can be NULL).
+     */
+    void chils_solve_batch(int count, const int *n, const long long *const *xadj, const int *const *adjncy,
+                           const long long *const *weights, const double *time_limit, const long long *iteration_limit,
+                           unsigned int seed, int *const *solutions, long long *solution_weights);
+
+    /**
+     * @brief Start chils_run_full in a background thread and return
+     * immediately. Graph validation and setup also happen in the
+     * background. The solution getters can be used while the solver
+     * runs, they return the best solution as of the last completed
+     * full or core phase. Use chils_poll for the latest weight.
+     *
+     * @attention Only one run can be active per solver. Call
+     * chils_wait before starting a new run or changing the graph and
+     * settings.
+     *
+     * @param solver pointer to the solver object.
+     * @param time_limit time limit in seconds.
+     * @param n_solutions number of concurrent solutions.
+     * @param seed seed for the random number generator.
+     *
+     * @return 1 if the run was started, 0 otherwise.
+     */
+    int chils_start_full(void *solver, double time_limit, int n_solutions, unsigned int seed);
+
+    /**
+     * @brief Start chils_run_local_search_only in a background thread
+     * and return immediately. Same rules as chils_start_full.
+     *
+     * @param solver pointer to the solver object.
+     * @param time_limit time limit in seconds.
+     * @param seed seed for the random number generator.
+     *
+     * @return 1 if the run was started, 0 otherwise.
+     */
+    int chils_start_local_search_only(void *solver, double time_limit, unsigned int seed);
+
+    /**
+     * @brief Check the progress of a run without blocking.
+     *
+     * @param solver pointer to the solver object.
+     * @param weight set to the best weight found so far (can be NULL).
+     * @param time set to the time the best weight was found (can be NULL).
+     *
+     * @return 1 while a background run is active, 0 otherwise.
+     */
+    int chils_poll(void *solver, long long *weight, double *time);
+
+    /**
+     * @brief Block until the background run ends. Returns immediately
+     * if no run was started.
+     *
+     * @param solver pointer to the solver object.
+     */
+    void chils_wait(void *solver);
+
+    /**
+     * @brief Ask the current run to stop as soon as possible, usually
+     * within a few milliseconds. The best solution found so far is
+     * kept. Does not block, use chils_wait to wait for the run to end.
+     * Safe to call from any thread, including the callback.
+     *
+     * @param solver pointer to the solver object.
+     */
+    void chils_cancel(void *solver);
+
+    /**
+     * @brief Set a function called each time a run finds a better
+     * solution, for both blocking and background runs. The callback
+     * is called from a solver thread while holding an internal lock,
+     * so it should return quickly and not call the solution getters.
+     *
+     * @param solver pointer to the solver object.
+     * @param callback the function to call, or NULL to disable.
+     * @param data passed unchanged to the callback.
+     */
+    void chils_set_callback(void *solver, void (*callback)(long long weight, double time, void *data), void *data);
+
     /**
      * @brief Extract the number of vertices in the best independent
      * set found by the heuristic.
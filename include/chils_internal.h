@@ -1,30 +1,155 @@
 #pragma once
 
 #include "local_search.h"
+#include "distributed.h"
 
+#include <pthread.h>
+
+// Most searches one thread interleaves, see chils.searches_per_thread
+#define CHILS_MAX_INTERLEAVE 8
+
+// Work units per solution in each CHILS interval, when only a total is given
+#define DEFAULT_STEP_WORK (1ll << 28)
+
+// Per solution state stored in a checkpoint
 typedef struct
+{
+    unsigned int seed;
+    int size, max_queue;
+    long long cost;
+    double time, age, full_time, core_time;
+} chils_checkpoint_entry;
+
+typedef struct
+{
+    int n, p, size;
+    unsigned int seed;
+    long long m, it, cost;
+    double time;
+} chils_checkpoint_header;
+
+typedef struct chils
 {
     int p;
+    unsigned int seed;
     double step_time;
     long long step_count;
 
+    // Deterministic mode, work units per solution in each full graph phase
+    // (LLONG_MAX to use step_time), and max total work per call to chils_run
+    long long step_work, work_limit;
+
+    // Time to build the last D-core, used to skip it close to the deadline
+    double core_build_time;
+
+    // Upper bound on the solution weight (LLONG_MAX until computed), and the
+    // relative gap to the bound that ends chils_run at the top level
+    long long upper_bound;
+    double gap_tolerance;
+
+    // The upper bound is computed by a helper thread started by chils_run, so the team
+    // never waits for it. The helper may outlive the run, it is joined by the next run
+    // once done, and stopped early by chils_update and chils_free
+    pthread_t cover_thread;
+    graph *cover_graph;
+    int cover_running, cover_done, cover_stop;
+
+    // chils_run also ends at the top level when the best solution reaches
+    // target_weight, or has not improved for stall_time seconds or
+    // stall_iterations iterations. target_time is when the target (or the
+    // gap) was reached in the last call, -1 if not
+    long long target_weight, stall_iterations;
+    double stall_time, target_time;
+    long long stall_cost, stall_it;
+    double stall_start;
+
     long long cost;
     int size;
     double time;
 
+    // LS_core[i] is allocated on the first D-core phase
     local_search **LS, **LS_core;
 
+    // Start from one parallel local maximum solution, reported before
+    // the rest of the pool is built
+    int fast_start;
+
+    // Searches on the full graph one thread runs together, one perturbation of each in turn,
+    // so the loads of one overlap with the work of the others. At most CHILS_MAX_INTERLEAVE
+    int searches_per_thread;
+
+    // Optional clique partition used by the searches on the full graph,
+    // not owned by c, see local_search_set_cliques
+    const graph_cliques *cliques;
+
+    // Optional hubs handled lazily by the searches on the full graph,
+    // not owned by c, see local_search_set_hubs
+    const graph_hubs *hubs;
+
+    // Optional interleaved adjacency for the searches on the full graph, not owned by c
+    const graph_neighbor *neighbors;
+
     graph *d_core;
     int *FM, *RM, *A;
+    int nt;
     long long *S1, *S2;
+
+    // Recursive CHILS on the D-core
+    int depth, max_depth, core_limit;
+    struct chils *sub;
+
+    // Adaptive step time, per solution durations of the full and core phase
+    int adaptive;
+    double *full_time, *core_time;
+
+    // Periodic checkpoints, written from a snapshot while the search continues
+    long long it;
+    const char *checkpoint_path;
+    double checkpoint_interval, checkpoint_last;
+    chils_checkpoint_header checkpoint_header;
+    chils_checkpoint_entry *checkpoint_entries;
+    unsigned char *checkpoint_bits;
+
+    // Exchange with other CHILS processes, not owned by c
+    chils_net *net;
+    unsigned char *net_bits;
+
+    // Progress reports and cancellation, not owned by c
+    local_search_control *control;
+
+    // Called at the top level whenever the best solution is updated
+    void (*on_best)(struct chils *c, void *data);
+    void *on_best_data;
 } chils;
 
 chils *chils_init(graph *g, int p, unsigned int seed);
 
 void chils_free(chils *c);
 
+// Grow or shrink the solution pool, keeping the best solutions
+void chils_resize(graph *g, chils *c, int p);
+
+// Repair all solutions after the graph changed from old to g, see local_search_update.
+// The clique partition belongs to the old graph and is dropped
+void chils_update(graph *old, graph *g, chils *c, const int *U, long long nu, const int *C, long long nc);
+
 void chils_run(graph *g, chils *c, double tl, long long cl, int verbose);
 
+// Total work units done by all searches, see local_search
+long long chils_work(chils *c);
+
+// Weight that reaches target_weight or closes the gap to the upper bound, LLONG_MAX if none
+long long chils_target(chils *c);
+
+// Same as chils_run, but should be called inside parallel region
+void chils_run_team(graph *g, chils *c, double tl, long long cl, int verbose);
+
 void chils_set_solution(graph *g, chils *c, int i, const int *I);
 
 int *chils_get_best_independent_set(chils *c);
+
+// Write the current state of c to path, returns 1 on success
+int chils_checkpoint_store(graph *g, chils *c, const char *path);
+
+// Restore the state of c from path, resizing the pool if needed, returns 1 on success
+int chils_checkpoint_load(graph *g, chils *c, const char *path);
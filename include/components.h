@@ -0,0 +1,37 @@
+#pragma once
+
+#include "graph.h"
+
+// Settings for the search on each component, see chils and local_search
+typedef struct
+{
+    int p, max_queue, max_depth, core_limit, adaptive, fast_start;
+    unsigned int seed;
+    double step_time;
+    long long step_count;
+} components_settings;
+
+typedef struct
+{
+    int k;        // Number of components
+    int *C;       // Component of each vertex
+    int *N;       // Vertices in each component
+    long long *M; // Edges in each component, counted twice
+    long long *X; // Offsets in L for each component
+    int *L;       // Vertices sorted by component
+} components;
+
+components *components_init(graph *g);
+
+void components_free(components *cc);
+
+/*
+    Solve each component on its own and store the combined solution in I.
+    Tiny components are solved exactly in parallel, large components get
+    their own search, and the rest share one.
+    Each phase gets a share of tl in proportion to size, tiny components
+    still left when the exact phase runs out of time are solved greedily.
+    Returns the weight of I, and the time the last improvement was found in time.
+*/
+long long components_solve(graph *g, components *cc, components_settings s, double tl, long long cl,
+                           int *I, double *time, int verbose);
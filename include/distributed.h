@@ -0,0 +1,37 @@
+#pragma once
+#include <stddef.h>
+
+/*
+    Solution exchange between several CHILS processes.
+
+    The processes form a star around rank 0, which merges the data
+    from every rank and sends the result back. The transport is a set
+    of function pointers, so other transports can be added without
+    touching the exchange logic. Addresses are given as either
+    unix:/path/to/socket or tcp:host:port.
+*/
+
+typedef struct chils_transport
+{
+    // Blocking send and receive of exactly len bytes to/from a peer, return 1 on success
+    int (*send)(struct chils_transport *t, int peer, const void *buf, size_t len);
+    int (*recv)(struct chils_transport *t, int peer, void *buf, size_t len);
+    void (*close)(struct chils_transport *t);
+    void *data;
+} chils_transport;
+
+typedef struct
+{
+    int rank, size;
+    chils_transport *t;
+} chils_net;
+
+chils_net *chils_net_init(const char *address, int rank, int size);
+
+void chils_net_free(chils_net *net);
+
+// Element-wise sum of data over all ranks, the result is stored in data on every rank
+int chils_net_sum(chils_net *net, int *data, size_t count);
+
+// Replace cost and bits on every rank with those of the rank with the highest cost
+int chils_net_best(chils_net *net, long long *cost, unsigned char *bits, size_t len);
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "graph.h"
+
+// Max weight independent set of a small graph g by branch and reduce, stored in I. Isolated
+// vertices are taken and dominated vertices removed at the root, below it only through degree one.
+// Returns 1 if the solution is optimal, or 0 if node_limit or the deadline (omp_get_wtime,
+// INFINITY if none) was reached first
+int exact_solve(graph *g, int *I, long long node_limit, double deadline);
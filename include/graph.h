@@ -1,5 +1,6 @@
 #pragma once
 #include <stdio.h>
+#include <stdint.h>
 
 typedef struct
 {
@@ -10,6 +11,29 @@ typedef struct
     long long *W; // Vertex weights
 } graph;
 
+// Edge-disjoint clique partition, every edge is in exactly one clique
+typedef struct
+{
+    int k;        // Number of cliques
+    long long *V; // Clique pointers for each vertex
+    int *E;       // Cliques of each vertex
+} graph_cliques;
+
+// Neighbor in the interleaved adjacency, with its weight next to it
+typedef struct
+{
+    int v, w;
+} graph_neighbor;
+
+// High degree vertices, at most 64 so the hubs next to a vertex fit in one word
+typedef struct
+{
+    int k;          // Number of hubs
+    int *H;         // Vertex of each hub
+    int *index;     // Hub of each vertex, or -1
+    uint64_t *mask; // Bit i is set for the neighbors of hub i
+} graph_hubs;
+
 graph *graph_parse(FILE *f);
 
 void graph_store(FILE *f, graph *g);
@@ -21,4 +45,46 @@ int graph_validate(graph *g);
 graph *graph_subgraph(graph *g, int *Mask, int *RM);
 
 // Should be called inside parallel region
-void graph_subgraph_par(graph *g, graph *sg, int *Mask, int *RM, int *FM, long long *S1, long long *S2);
\ No newline at end of file
+void graph_subgraph_par(graph *g, graph *sg, int *Mask, int *RM, int *FM, long long *S1, long long *S2);
+
+// Upper bound on the weight of any independent set, from a greedy weighted clique cover.
+// Gives up and returns LLONG_MAX once *stop is set, stop may be NULL
+long long graph_clique_cover(graph *g, const int *stop);
+
+/*
+    Conflict graph of n axis-aligned boxes in d dimensions, box u spans lo[u * d + k] to
+    hi[u * d + k] in dimension k. Two boxes conflict if their interiors intersect, so
+    boxes that only touch do not. Intervals are boxes with d = 1. Neighborhoods are
+    enumerated in parallel from a grid over the first two dimensions and stored as CSR,
+    so memory grows with the number of conflicts.
+*/
+graph *graph_from_boxes(int n, int d, const double *lo, const double *hi, const long long *W);
+
+// Greedy edge-disjoint clique partition of g, NULL if it does not have
+// substantially fewer clique memberships than edges
+graph_cliques *graph_clique_partition(graph *g);
+
+void graph_cliques_free(graph_cliques *K);
+
+// Copy of g->E with the weight of each neighbor next to it, so scans that filter by weight
+// read one stream instead of gathering from g->W. NULL if some weight does not fit in an int
+graph_neighbor *graph_interleave(graph *g);
+
+// The (up to 64) vertices of highest degree among those with at least min_degree neighbors,
+// NULL if there are none
+graph_hubs *graph_hubs_init(graph *g, int min_degree);
+
+void graph_hubs_free(graph_hubs *H);
+
+// Label the connected components in parallel, numbered 0 to k - 1 by their smallest vertex. Returns k
+int graph_components_par(graph *g, int *C);
+
+/*
+    Apply a batch of edge changes to g and store the result in ng, with
+    n >= g->n vertices and newly allocated arrays. Change i is the edge {X[i], Y[i]},
+    inserted if D[i] > 0 and deleted otherwise, later changes to the
+    same edge take precedence. Weights of new vertices are set to 0.
+    The vertices with changed neighborhoods are stored in U (size 2k),
+    and the number of them is returned.
+*/
+long long graph_update(graph *g, graph *ng, int n, const int *X, const int *Y, const int *D, long long k, int *U);
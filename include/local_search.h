@@ -2,6 +2,19 @@
 
 #include "graph.h"
 
+#include <math.h>
+#include <omp.h>
+
+// Shared between concurrent searches, to report improvements and to stop early
+typedef struct
+{
+    int stop;
+    long long best;
+    double time;
+    void (*callback)(long long cost, double time, void *data);
+    void *data;
+} local_search_control;
+
 typedef struct
 {
     // Solution
@@ -15,6 +28,9 @@ typedef struct
     int *queue, *in_queue;
     int *prev_queue, *in_prev_queue;
 
+    // A greedy pass cut short leaves prev_queue[prev_queue_start..prev_queue_count) for the next one
+    int prev_queue_start, prev_queue_count;
+
     // Graph structures
     int max_queue;
     long long *adjacent_weight;
@@ -26,14 +42,95 @@ typedef struct
     int *log;
 
     unsigned int seed;
+
+    // Work units (edges and queue entries visited), and the max per call to local_search_explore
+    long long work, work_limit;
+
+    // Time (omp_get_wtime) when greedy and AAP give up, INFINITY if none
+    double deadline;
+
+    // local_search_explore returns once the cost, or the best reported to control, reaches stop_weight
+    long long stop_weight;
+
+    // local_search_explore also returns after this long without improvement, INFINITY and LLONG_MAX if never,
+    // stalled is the number of iterations since the last improvement when it returned
+    double stall_time;
+    long long stall_iterations, stalled;
+
+    // Optional, report marks searches on the full graph
+    local_search_control *control;
+    int report;
+
+    // Optional clique partition of the graph, see local_search_set_cliques.
+    // When set, the solution vertex in each clique (or -1) replaces adjacent_weight and tightness
+    const graph_cliques *cliques;
+    int *occupant, *clique_mask;
+
+    // Optional hubs of the graph, see local_search_set_hubs. adjacent_weight, tightness and tabu
+    // leave out the hubs, which are added from the hubs in the solution (hub_active) when read.
+    // Hub i queues its neighbors from hub_cursor[i] a window at a time
+    const graph_hubs *hubs;
+    uint64_t hub_active, hub_locked;
+    long long *hub_cursor;
+
+    // Optional interleaved adjacency of the graph, see graph_interleave
+    const graph_neighbor *neighbors;
 } local_search;
 
+// State of local_search_explore between steps
+typedef struct
+{
+    long long best, c, il, work_start, improved_it;
+    double deadline, improved;
+    int verbose;
+
+    // Vertex the next perturbation starts from, and how far it is prefetched
+    int next, stage;
+} local_search_run;
+
 local_search *local_search_init(graph *g, unsigned int seed);
 
+// Same as local_search_init, but with an empty queue and without touching the O(n) arrays
+local_search *local_search_init_lazy(graph *g, unsigned int seed);
+
+// Queue every vertex not already in the queue
+void local_search_queue_all(graph *g, local_search *ls);
+
 void local_search_free(local_search *ls);
 
 void local_search_reset(graph *g, local_search *ls);
 
+// Recompute the state from ls->independent_set, should be called inside parallel region
+void local_search_rebuild_par(graph *g, local_search *ls);
+
+// Set the solution to the vertices marked in I, the lighter endpoint of any
+// edge inside I is left out. Should be called inside parallel region
+void local_search_set_solution_par(graph *g, local_search *ls, const int *I);
+
+// Parallel initial solution in rounds, an undecided vertex joins when it has a higher
+// weight to degree ratio than all its undecided neighbors. S is scratch space with
+// one entry per thread. Should be called inside parallel region
+void local_search_priority_par(graph *g, local_search *ls, long long *S);
+
+// Copy the solution of src on a graph with n vertices, dst must not have tabu vertices and use the same cliques
+void local_search_copy(local_search *dst, local_search *src, int n);
+
+// Make room for n vertices, the new vertices 'old_n' to n - 1 are queued and not in the solution
+void local_search_grow(local_search *ls, int old_n, int n);
+
+// Repair the solution after the graph changed from old to g, see graph_update.
+// U lists the vertices with changed neighborhoods and C those with changed weights, without repeats.
+void local_search_update(graph *old, graph *g, local_search *ls, const int *U, long long nu, const int *C, long long nc);
+
+// Track the solution per clique of K instead of per vertex, or per vertex again if K is NULL.
+// Adding a vertex then costs one step per clique instead of one per neighbor
+void local_search_set_cliques(graph *g, local_search *ls, const graph_cliques *K);
+
+// Handle the hubs of H lazily, or none if H is NULL. Adding or removing a hub then only
+// changes one bit, and removing it queues a window of its neighbors instead of all of them.
+// Not used together with cliques
+void local_search_set_hubs(graph *g, local_search *ls, const graph_hubs *H);
+
 void local_search_in_order_solution(graph *g, local_search *ls);
 
 void local_search_add_vertex(graph *g, local_search *ls, int u);
@@ -52,8 +149,107 @@ void local_search_perturbe(graph *g, local_search *ls);
 
 void local_search_explore(graph *g, local_search *ls, double tl, long long il, int verbose);
 
+// local_search_explore one perturbation at a time, so one thread can interleave several searches.
+// local_search_explore_step returns 0 once the run is over, and local_search_explore_end is called after
+void local_search_explore_begin(graph *g, local_search *ls, local_search_run *r, double tl, long long il, int verbose);
+
+int local_search_explore_step(graph *g, local_search *ls, local_search_run *r);
+
+void local_search_explore_end(local_search *ls, local_search_run *r);
+
+// Prefetch the next step of r a stage further, first the vertex the perturbation starts
+// from, then its neighborhood, then the state of its neighbors. Meant to be called while
+// other searches run, each call should find the loads of the previous one done
+void local_search_prefetch_step(graph *g, local_search *ls, local_search_run *r);
+
 void local_search_unwind(graph *g, local_search *ls, int t);
 
+// Report the current solution to ls->control if it is the best so far
+void local_search_report(local_search *ls);
+
+static inline int local_search_stopped(local_search *ls)
+{
+    int stop = 0;
+    if (ls->control != NULL)
+    {
+        long long best;
+#pragma omp atomic read
+        stop = ls->control->stop;
+#pragma omp atomic read
+        best = ls->control->best;
+        // Another search reached the target
+        stop = stop || best >= ls->stop_weight;
+    }
+    return stop || (ls->deadline < INFINITY && omp_get_wtime() >= ls->deadline);
+}
+
+// Weight of the neighbor g->E[i], from the interleaved adjacency if there is one
+static inline long long local_search_neighbor_weight(graph *g, local_search *ls, long long i)
+{
+    return ls->neighbors != NULL ? ls->neighbors[i].w : g->W[g->E[i]];
+}
+
+static inline int local_search_is_hub(local_search *ls, int u)
+{
+    return ls->hubs != NULL && ls->hubs->index[u] >= 0;
+}
+
+// Nonzero if u can not change, locked itself or next to a locked vertex in the solution
+static inline int local_search_tabu(local_search *ls, int u)
+{
+    return ls->tabu[u] || (ls->hubs != NULL && (ls->hubs->mask[u] & ls->hub_locked));
+}
+
+// Number of neighbors of u in the solution
+static inline int local_search_tightness(local_search *ls, int u)
+{
+    if (ls->hubs != NULL)
+        return ls->tightness[u] + __builtin_popcountll(ls->hubs->mask[u] & ls->hub_active);
+    if (ls->cliques == NULL)
+        return ls->tightness[u];
+
+    int tightness = 0;
+    for (long long i = ls->cliques->V[u]; i < ls->cliques->V[u + 1]; i++)
+    {
+        int v = ls->occupant[ls->cliques->E[i]];
+        tightness += v >= 0 && v != u;
+    }
+    return tightness;
+}
+
+// Total weight of the neighbors of u in the solution
+static inline long long local_search_adjacent_weight(graph *g, local_search *ls, int u)
+{
+    if (ls->hubs != NULL)
+    {
+        long long adjacent_weight = ls->adjacent_weight[u];
+        for (uint64_t X = ls->hubs->mask[u] & ls->hub_active; X; X &= X - 1)
+            adjacent_weight += g->W[ls->hubs->H[__builtin_ctzll(X)]];
+        return adjacent_weight;
+    }
+    if (ls->cliques == NULL)
+        return ls->adjacent_weight[u];
+
+    long long adjacent_weight = 0;
+    for (long long i = ls->cliques->V[u]; i < ls->cliques->V[u + 1]; i++)
+    {
+        int v = ls->occupant[ls->cliques->E[i]];
+        if (v >= 0 && v != u)
+            adjacent_weight += g->W[v];
+    }
+    return adjacent_weight;
+}
+
+// Start loading the state of u, ahead of a visit to it
+static inline void local_search_prefetch(graph *g, local_search *ls, int u)
+{
+    __builtin_prefetch(ls->independent_set + u);
+    __builtin_prefetch(ls->tabu + u);
+    __builtin_prefetch(ls->tightness + u);
+    __builtin_prefetch(ls->adjacent_weight + u);
+    __builtin_prefetch(g->V + u);
+}
+
 static inline int my_rand_r(unsigned int *seed)
 {
     unsigned int next = *seed;
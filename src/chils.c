@@ -5,7 +5,14 @@
 #include "local_search.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <omp.h>
+
+// Interval between solution snapshots when running local search in the background
+#define ASYNC_SLICE 0.05
 
 typedef struct
 {
@@ -16,6 +23,56 @@ typedef struct
     long long *W;
     int *X, *Y;
 
+    int validated, borrowed, borrowed_xadj, borrowed_weights;
+
+    // Pending changes to the graph, applied before the next run
+    long long uk, _auk, uc, _auc;
+    int un;
+    int *UX, *UY, *UD, *UC;
+    long long *UW;
+
+    // Initial solutions waiting for the next run, slot -1 means all
+    int initial_count, *initial_slot, *initial_n;
+    int **initial;
+    int max_depth, min_core, adaptive;
+    long long work_limit, step_work;
+    int fast_start, searches_per_thread;
+
+    // Clique partition of the graph, built on first use when enabled
+    int use_cliques, cliques_tried;
+    graph_cliques *cliques;
+
+    int hub_degree, hubs_tried;
+    graph_hubs *hubs;
+
+    int use_interleave, interleave_tried;
+    graph_neighbor *neighbors;
+
+    // Upper bound on the solution weight, LLONG_MAX until computed
+    long long upper_bound;
+    double gap_tolerance;
+
+    // Early stopping, target_time is -1 until a run reaches its target
+    long long target_weight, stall_iterations;
+    double stall_time, target_time;
+
+    // Deadlines, measured from the API call when total_time is set
+    int total_time;
+    double call_start, deadline;
+    long long overshoot_count;
+    double overshoot_last, overshoot_max, overshoot_sum;
+    char *checkpoint_path;
+    double checkpoint_interval;
+    chils_net *net;
+
+    // Background runs, lock protects the best solution below
+    local_search_control control;
+    pthread_mutex_t lock;
+    pthread_t thread;
+    int running, active, async_full, async_n;
+    double async_time_limit;
+    unsigned int async_seed;
+
     graph *g;
     chils *c;
     local_search *ls;
@@ -41,6 +98,66 @@ void *chils_initialize()
     d->X = malloc(sizeof(int) * d->_am);
     d->Y = malloc(sizeof(int) * d->_am);
 
+    d->validated = 0;
+    d->borrowed = 0;
+    d->borrowed_xadj = 0;
+    d->borrowed_weights = 0;
+
+    d->uk = 0;
+    d->uc = 0;
+    d->un = 0;
+    d->_auk = 0;
+    d->_auc = 0;
+    d->UX = NULL;
+    d->UY = NULL;
+    d->UD = NULL;
+    d->UC = NULL;
+    d->UW = NULL;
+
+    d->initial_count = 0;
+    d->initial_slot = NULL;
+    d->initial_n = NULL;
+    d->initial = NULL;
+
+    d->max_depth = 0;
+    d->min_core = 1 << 16;
+    d->adaptive = 0;
+    d->work_limit = LLONG_MAX;
+    d->step_work = LLONG_MAX;
+    d->fast_start = 0;
+    d->searches_per_thread = 1;
+    d->use_cliques = 0;
+    d->cliques_tried = 0;
+    d->cliques = NULL;
+    d->hub_degree = 0;
+    d->hubs_tried = 0;
+    d->hubs = NULL;
+    d->use_interleave = 0;
+    d->interleave_tried = 0;
+    d->neighbors = NULL;
+    d->upper_bound = LLONG_MAX;
+    d->gap_tolerance = 0.0;
+    d->target_weight = LLONG_MAX;
+    d->stall_iterations = LLONG_MAX;
+    d->stall_time = INFINITY;
+    d->target_time = -1.0;
+
+    d->total_time = 0;
+    d->call_start = 0.0;
+    d->deadline = 0.0;
+    d->overshoot_count = 0;
+    d->overshoot_last = 0.0;
+    d->overshoot_max = 0.0;
+    d->overshoot_sum = 0.0;
+    d->checkpoint_path = NULL;
+    d->checkpoint_interval = 60.0;
+    d->net = NULL;
+
+    d->control = (local_search_control){.stop = 0, .best = 0, .time = 0.0, .callback = NULL, .data = NULL};
+    pthread_mutex_init(&d->lock, NULL);
+    d->running = 0;
+    d->active = 0;
+
     d->g = NULL;
     d->c = NULL;
     d->ls = NULL;
@@ -53,25 +170,95 @@ void *chils_initialize()
     return d;
 }
 
+// Drop the structures built from the graph
+static void chils_api_free_derived(api_data *d)
+{
+    graph_cliques_free(d->cliques);
+    d->cliques = NULL;
+    d->cliques_tried = 0;
+
+    graph_hubs_free(d->hubs);
+    d->hubs = NULL;
+    d->hubs_tried = 0;
+
+    free(d->neighbors);
+    d->neighbors = NULL;
+    d->interleave_tried = 0;
+}
+
+static void chils_api_free_graph(api_data *d)
+{
+    if (d->borrowed && d->g != NULL)
+    {
+        if (!d->borrowed_xadj)
+            free(d->g->V);
+        if (!d->borrowed_weights)
+            free(d->g->W);
+        free(d->g);
+    }
+    else
+    {
+        graph_free(d->g);
+    }
+    d->g = NULL;
+
+    chils_api_free_derived(d);
+}
+
 void chils_release(void *solver)
 {
     api_data *d = (api_data *)solver;
 
+    chils_cancel(solver);
+    chils_wait(solver);
+    pthread_mutex_destroy(&d->lock);
+
     free(d->W);
     free(d->X);
     free(d->Y);
 
-    graph_free(d->g);
+    free(d->UX);
+    free(d->UY);
+    free(d->UD);
+    free(d->UC);
+    free(d->UW);
+
+    for (int i = 0; i < d->initial_count; i++)
+        free(d->initial[i]);
+    free(d->initial);
+    free(d->initial_slot);
+    free(d->initial_n);
+
+    // The searches go first, a helper thread of d->c may still read the graph
     chils_free(d->c);
     local_search_free(d->ls);
+    chils_api_free_graph(d);
+    free(d->IS);
+    free(d->checkpoint_path);
+    chils_net_free(d->net);
 
     free(d);
 }
 
+// Settings the search holds on to, and the graph, can only change between runs
+static int chils_api_idle(api_data *d)
+{
+    if (d->running)
+    {
+        fprintf(stderr, "The graph and settings can not be changed while the solver is running, use chils_wait first\n");
+        return 0;
+    }
+
+    return 1;
+}
+
 int chils_add_vertex(void *solver, long long weight)
 {
     api_data *d = (api_data *)solver;
 
+    if (!chils_api_idle(d))
+        return -1;
+
     if (d->n >= INT_MAX - 1)
     {
         fprintf(stderr, "Number of vertices must be less than %d\n", INT_MAX);
@@ -94,6 +281,9 @@ void chils_add_edge(void *solver, int u, int v)
 {
     api_data *d = (api_data *)solver;
 
+    if (!chils_api_idle(d))
+        return;
+
     if (d->m == d->_am)
     {
         d->_am *= 2;
@@ -106,192 +296,1461 @@ void chils_add_edge(void *solver, int u, int v)
     d->m++;
 }
 
+int chils_add_vertices(void *solver, int count, const long long *weights)
+{
+    api_data *d = (api_data *)solver;
+
+    if (!chils_api_idle(d))
+        return -1;
+
+    if ((long long)d->n + count >= INT_MAX - 1)
+    {
+        fprintf(stderr, "Number of vertices must be less than %d\n", INT_MAX);
+        exit(1);
+    }
+
+    if (d->n + count > d->_an)
+    {
+        while (d->n + count > d->_an)
+            d->_an *= 2;
+        d->W = realloc(d->W, sizeof(long long) * d->_an);
+    }
+
+    int first = d->n;
+
+#pragma omp parallel for
+    for (int i = 0; i < count; i++)
+        d->W[first + i] = weights[i];
+
+    d->n += count;
+
+    return first;
+}
+
+void chils_add_edges(void *solver, long long count, const int *u, const int *v)
+{
+    api_data *d = (api_data *)solver;
+
+    if (!chils_api_idle(d))
+        return;
+
+    if (d->m + count > d->_am)
+    {
+        while (d->m + count > d->_am)
+            d->_am *= 2;
+        d->X = realloc(d->X, sizeof(int) * d->_am);
+        d->Y = realloc(d->Y, sizeof(int) * d->_am);
+    }
+
+    long long first = d->m;
+
+#pragma omp parallel for
+    for (long long i = 0; i < count; i++)
+    {
+        d->X[first + i] = u[i];
+        d->Y[first + i] = v[i];
+    }
+
+    d->m += count;
+}
+
+/*
+    Replace the graph, and drop everything that belongs to the previous one:
+    the searches, the stored solution, and waiting updates and initial solutions
+*/
+static void chils_api_replace_graph(api_data *d, graph *g, int borrowed, int borrowed_xadj, int validated)
+{
+    chils_free(d->c);
+    d->c = NULL;
+    local_search_free(d->ls);
+    d->ls = NULL;
+    chils_api_free_graph(d);
+
+    d->uk = 0;
+    d->uc = 0;
+    d->un = 0;
+    for (int i = 0; i < d->initial_count; i++)
+        free(d->initial[i]);
+    d->initial_count = 0;
+
+    pthread_mutex_lock(&d->lock);
+    free(d->IS);
+    d->IS = NULL;
+    d->cost = 0;
+    d->size = 0;
+    d->time = 0.0;
+    d->upper_bound = LLONG_MAX;
+    pthread_mutex_unlock(&d->lock);
+
+    d->g = g;
+    d->borrowed = borrowed;
+    d->borrowed_xadj = borrowed_xadj;
+    d->borrowed_weights = borrowed;
+    d->validated = validated;
+}
+
 void chils_set_graph(void *solver, int n, const long long *xadj, const int *adjncy, const long long *weights)
 {
     api_data *d = (api_data *)solver;
 
-    d->g = malloc(sizeof(graph));
-    d->g->n = n;
-    d->g->m = xadj[n];
-    d->g->V = malloc(sizeof(long long) * (n + 1));
-    d->g->E = malloc(sizeof(int) * xadj[n]);
-    d->g->W = malloc(sizeof(long long) * n);
+    if (!chils_api_idle(d))
+        return;
+
+    graph *g = malloc(sizeof(graph));
+    g->n = n;
+    g->m = xadj[n];
+    g->V = malloc(sizeof(long long) * (n + 1));
+    g->E = malloc(sizeof(int) * xadj[n]);
+    g->W = malloc(sizeof(long long) * n);
 
-    for (int u = 0; u <= n; u++)
-        d->g->V[u] = xadj[u];
+#pragma omp parallel
+    {
+#pragma omp for nowait
+        for (int u = 0; u <= n; u++)
+            g->V[u] = xadj[u];
 
-    for (long long i = 0; i < xadj[n]; i++)
-        d->g->E[i] = adjncy[i];
+#pragma omp for nowait
+        for (long long i = 0; i < xadj[n]; i++)
+            g->E[i] = adjncy[i];
 
-    for (int u = 0; u < n; u++)
-        d->g->W[u] = weights[u];
+#pragma omp for nowait
+        for (int u = 0; u < n; u++)
+            g->W[u] = weights[u];
+    }
+
+    chils_api_replace_graph(d, g, 0, 0, 0);
 }
 
-static inline int chils_api_compare(const void *a, const void *b)
+void chils_set_graph_borrowed(void *solver, int n, const long long *xadj, const int *adjncy,
+                              const long long *weights, int validate)
 {
-    return (*(int *)a - *(int *)b);
+    api_data *d = (api_data *)solver;
+
+    if (!chils_api_idle(d))
+        return;
+
+    graph *g = malloc(sizeof(graph));
+    *g = (graph){.n = n, .m = xadj[n], .V = (long long *)xadj, .E = (int *)adjncy, .W = (long long *)weights};
+
+    chils_api_replace_graph(d, g, 1, 1, !validate);
 }
 
-void chils_construct_graph(api_data *d)
+void chils_set_graph_borrowed32(void *solver, int n, const int *xadj, const int *adjncy,
+                                const long long *weights, int validate)
+{
+    api_data *d = (api_data *)solver;
+
+    if (!chils_api_idle(d))
+        return;
+
+    // Only the n + 1 offsets are widened, the edges and weights are borrowed
+    long long *V = malloc(sizeof(long long) * (n + 1));
+
+#pragma omp parallel for
+    for (int u = 0; u <= n; u++)
+        V[u] = xadj[u];
+
+    graph *g = malloc(sizeof(graph));
+    *g = (graph){.n = n, .m = V[n], .V = V, .E = (int *)adjncy, .W = (long long *)weights};
+
+    chils_api_replace_graph(d, g, 1, 0, !validate);
+}
+
+void chils_set_boxes(void *solver, int n, int dimensions, const double *lo, const double *hi,
+                     const long long *weights)
 {
-    long long *V = malloc(sizeof(long long) * (d->n + 1));
-    int *E = malloc(sizeof(int) * d->m * 2);
-    long long *W = malloc(sizeof(long long) * d->n);
+    api_data *d = (api_data *)solver;
+
+    if (!chils_api_idle(d))
+        return;
 
-    for (int i = 0; i < d->n; i++)
-        W[i] = d->W[i];
+    chils_api_replace_graph(d, graph_from_boxes(n, dimensions, lo, hi, weights), 0, 0, 1);
+}
 
-    for (int i = 0; i <= d->n; i++)
-        V[i] = 0;
+// Neighborhoods up to this size are sorted by insertion instead of radix sort
+#define INSERTION_SORT_LIMIT 64
 
-    for (int i = 0; i < d->m; i++)
+static inline void chils_api_insertion_sort(int *A, long long n)
+{
+    for (long long i = 1; i < n; i++)
     {
-        if (d->X[i] < 0 || d->X[i] >= d->n || d->Y[i] < 0 || d->Y[i] >= d->n)
+        int x = A[i];
+        long long j = i;
+        while (j > 0 && A[j - 1] > x)
         {
-            fprintf(stderr, "Invalid edge {%d,%d} in graph with %d vertices\n", d->X[i], d->Y[i], d->n);
-            continue;
+            A[j] = A[j - 1];
+            j--;
         }
-        V[d->X[i] + 1]++;
-        V[d->Y[i] + 1]++;
+        A[j] = x;
     }
+}
 
-    int ps = 0;
-    for (int i = 1; i <= d->n; i++)
+// LSD radix sort on non-negative keys, 8 bits per pass, T is a buffer of size n
+static inline void chils_api_radix_sort(int *A, int *T, long long n)
+{
+    int max = 0;
+    for (long long i = 0; i < n; i++)
+        if (A[i] > max)
+            max = A[i];
+
+    int *src = A, *dst = T;
+    for (int shift = 0; shift < 32 && (max >> shift) > 0; shift += 8)
     {
-        ps += V[i];
-        V[i] = ps - V[i];
+        long long count[257] = {0};
+        for (long long i = 0; i < n; i++)
+            count[((src[i] >> shift) & 255) + 1]++;
+        for (int b = 0; b < 256; b++)
+            count[b + 1] += count[b];
+        for (long long i = 0; i < n; i++)
+            dst[count[(src[i] >> shift) & 255]++] = src[i];
+
+        int *t = src;
+        src = dst;
+        dst = t;
     }
 
-    for (long long i = 0; i < d->m; i++)
+    if (src != A)
+        for (long long i = 0; i < n; i++)
+            A[i] = src[i];
+}
+
+/*
+    Turn the counts in V[1..n] into offsets, V[0] is set to 0.
+    S is a buffer with one entry per thread.
+    Should be called inside parallel region
+*/
+static void chils_api_prefix_sum(long long *V, int n, long long *S)
+{
+    int tid = omp_get_thread_num(), nt = omp_get_num_threads();
+    long long chunk = ((long long)n + nt - 1) / nt;
+    long long start = 1 + chunk * tid, end = start + chunk > (long long)n + 1 ? (long long)n + 1 : start + chunk;
+
+    long long sum = 0;
+    for (long long u = start; u < end; u++)
+        sum += V[u];
+    S[tid] = sum;
+
+#pragma omp barrier
+#pragma omp single
     {
-        if (d->X[i] < 0 || d->X[i] >= d->n || d->Y[i] < 0 || d->Y[i] >= d->n)
+        V[0] = 0;
+        long long offset = 0;
+        for (int t = 0; t < nt; t++)
         {
-            continue;
+            long long x = S[t];
+            S[t] = offset;
+            offset += x;
         }
-        E[V[d->X[i] + 1]++] = d->Y[i];
-        E[V[d->Y[i] + 1]++] = d->X[i];
     }
 
-    for (int i = 0; i < d->n; i++)
-        qsort(E + V[i], V[i + 1] - V[i], sizeof(int), chils_api_compare);
+    sum = S[tid];
+    for (long long u = start; u < end; u++)
+    {
+        sum += V[u];
+        V[u] = sum;
+    }
+#pragma omp barrier
+}
 
-    long long p = 0;
-    for (int u = 0; u < d->n; u++)
+void chils_construct_graph(api_data *d)
+{
+    int n = d->n, reported = 0;
+    long long *V = malloc(sizeof(long long) * (n + 1));
+    long long *P = malloc(sizeof(long long) * (n + 1));
+    long long *W = malloc(sizeof(long long) * n);
+    int *E = malloc(sizeof(int) * (d->m * 2 + 1));
+    long long *S = NULL;
+
+#pragma omp parallel
     {
-        int s = p;
-        for (long long i = V[u]; i < V[u + 1]; i++)
+#pragma omp single
+        S = malloc(sizeof(long long) * omp_get_num_threads());
+
+#pragma omp for
+        for (int u = 0; u < n; u++)
+        {
+            W[u] = d->W[u];
+            V[u + 1] = 0;
+        }
+
+        // Degrees, self edges are dropped
+#pragma omp for
+        for (long long i = 0; i < d->m; i++)
+        {
+            int u = d->X[i], v = d->Y[i];
+            if (u < 0 || u >= n || v < 0 || v >= n)
+            {
+#pragma omp critical(chils_api_report)
+                {
+                    if (reported++ < 10)
+                        fprintf(stderr, "Invalid edge {%d,%d} in graph with %d vertices\n", u, v, n);
+                }
+                continue;
+            }
+            if (u == v)
+                continue;
+
+#pragma omp atomic
+            V[u + 1]++;
+#pragma omp atomic
+            V[v + 1]++;
+        }
+
+        chils_api_prefix_sum(V, n, S);
+
+#pragma omp for
+        for (int u = 0; u < n; u++)
+            P[u] = V[u];
+
+#pragma omp for
+        for (long long i = 0; i < d->m; i++)
         {
-            int v = E[i];
-            if (u == v || (i > V[u] && v <= E[i - 1]))
+            int u = d->X[i], v = d->Y[i];
+            if (u < 0 || u >= n || v < 0 || v >= n || u == v)
                 continue;
 
-            E[p++] = v;
+            long long pu, pv;
+#pragma omp atomic capture
+            pu = P[u]++;
+#pragma omp atomic capture
+            pv = P[v]++;
+
+            E[pu] = v;
+            E[pv] = u;
+        }
+
+        // Sort and remove duplicates, the new degree is stored in P
+        int *T = NULL;
+        long long capacity = 0;
+#pragma omp for schedule(dynamic, 1024)
+        for (int u = 0; u < n; u++)
+        {
+            int *A = E + V[u];
+            long long degree = V[u + 1] - V[u];
+            if (degree <= INSERTION_SORT_LIMIT)
+            {
+                chils_api_insertion_sort(A, degree);
+            }
+            else
+            {
+                if (degree > capacity)
+                {
+                    capacity = degree;
+                    T = realloc(T, sizeof(int) * capacity);
+                }
+                chils_api_radix_sort(A, T, degree);
+            }
+
+            long long p = 0;
+            for (long long i = 0; i < degree; i++)
+                if (i == 0 || A[i] != A[i - 1])
+                    A[p++] = A[i];
+            P[u + 1] = p;
+        }
+        free(T);
+
+        chils_api_prefix_sum(P, n, S);
+
+        // Compact in place, first each thread packs its block of vertices, then the blocks are moved in order
+        int tid = omp_get_thread_num(), nt = omp_get_num_threads();
+        long long chunk = ((long long)n + nt - 1) / nt;
+        long long start = chunk * tid < n ? chunk * tid : n, end = start + chunk < n ? start + chunk : n;
+        for (long long u = start; u < end; u++)
+            memmove(E + V[start] + (P[u] - P[start]), E + V[u], sizeof(int) * (P[u + 1] - P[u]));
+
+#pragma omp barrier
+#pragma omp single
+        {
+            for (int t = 0; t < nt; t++)
+            {
+                long long first = chunk * t < n ? chunk * t : n, last = first + chunk < n ? first + chunk : n;
+                memmove(E + P[first], E + V[first], sizeof(int) * (P[last] - P[first]));
+            }
         }
-        V[u] = s;
     }
-    V[d->n] = p;
 
-    E = realloc(E, sizeof(int) * p);
+    if (reported > 10)
+        fprintf(stderr, "%d invalid edges in total\n", reported);
+
+    E = realloc(E, sizeof(int) * (P[n] + 1));
+    free(V);
+    free(S);
 
     graph *g = malloc(sizeof(graph));
-    *g = (graph){.n = d->n, .m = p, .V = V, .E = E, .W = W};
+    *g = (graph){.n = n, .m = P[n], .V = P, .E = E, .W = W};
 
     d->g = g;
 }
 
-void chils_run_full(void *solver, double time_limit, int n_solutions, unsigned int seed)
+static inline void chils_api_store_solution(api_data *d, const int *IS)
 {
-    api_data *d = (api_data *)solver;
+    if (d->IS == NULL)
+        d->IS = malloc(sizeof(int) * d->g->n);
 
-    if (d->g == NULL)
-        chils_construct_graph(d);
+#pragma omp parallel for
+    for (int u = 0; u < d->g->n; u++)
+        d->IS[u] = IS[u];
+}
 
-    if (!graph_validate(d->g))
+static void chils_api_store(api_data *d, long long cost, int size, double time, const int *IS)
+{
+    pthread_mutex_lock(&d->lock);
+    if (d->cost < cost || (d->cost == cost && d->time > time))
     {
-        fprintf(stderr, "Detected errors in the graph, make sure "
-                        "there are no self edges or missing endpoints\n");
-        return;
+        d->cost = cost;
+        d->size = size;
+        d->time = time;
+        chils_api_store_solution(d, IS);
     }
+    pthread_mutex_unlock(&d->lock);
+}
 
-    if (d->c == NULL)
-        d->c = chils_init(d->g, n_solutions, seed);
+static int chils_api_update_list_compare(const void *a, const void *b)
+{
+    return (*(int *)a > *(int *)b) - (*(int *)a < *(int *)b);
+}
 
-    chils_run(d->g, d->c, time_limit, LLONG_MAX, 0);
+/*
+    The graph after a batch without edge changes, with new weights and n >= old->n
+    vertices. The edges are shared with old, and the offsets unless vertices are added.
+    old stays intact, the searches still read it while they are updated.
+*/
+static graph *chils_api_extend_graph(graph *old, int n)
+{
+    long long *V = old->V, *W = malloc(sizeof(long long) * n);
+    if (n > old->n)
+        V = malloc(sizeof(long long) * (n + 1));
 
-    if (d->cost < d->c->cost || (d->cost == d->c->cost && d->time > d->c->time))
+#pragma omp parallel
     {
-        d->cost = d->c->cost;
-        d->size = d->c->size;
-        d->time = d->c->time;
-        d->IS = chils_get_best_independent_set(d->c);
+        if (n > old->n)
+        {
+#pragma omp for nowait
+            for (int u = 0; u <= n; u++)
+                V[u] = old->V[u < old->n ? u : old->n];
+        }
+
+#pragma omp for nowait
+        for (int u = 0; u < n; u++)
+            W[u] = u < old->n ? old->W[u] : 0;
     }
+
+    graph *g = malloc(sizeof(graph));
+    *g = (graph){.n = n, .m = old->m, .V = V, .E = old->E, .W = W};
+
+    return g;
 }
 
-void chils_run_local_search_only(void *solver, double time_limit, unsigned int seed)
+static void chils_api_apply_updates(api_data *d)
 {
-    api_data *d = (api_data *)solver;
+    if (d->uk == 0 && d->uc == 0)
+        return;
+
+    // Weight changes and isolated new vertices keep the adjacency, other batches rebuild it
+    graph *old = d->g, *g = NULL;
+    int *U = malloc(sizeof(int) * (2 * d->uk + 1));
+    long long nu = 0;
+    if (d->uk > 0)
+    {
+        g = malloc(sizeof(graph));
+        nu = graph_update(old, g, old->n + d->un, d->UX, d->UY, d->UD, d->uk, U);
+    }
+    else
+    {
+        g = chils_api_extend_graph(old, old->n + d->un);
+    }
+
+    // Later weight changes to the same vertex take precedence
+    long long nc = 0;
+    for (long long i = 0; i < d->uc; i++)
+    {
+        g->W[d->UC[i]] = d->UW[i];
+        d->UC[nc++] = d->UC[i];
+    }
+    qsort(d->UC, nc, sizeof(int), chils_api_update_list_compare);
+    long long p = 0;
+    for (long long i = 0; i < nc; i++)
+        if (i == 0 || d->UC[i] != d->UC[i - 1])
+            d->UC[p++] = d->UC[i];
+    nc = p;
+
+    if (d->c != NULL)
+        chils_update(old, g, d->c, U, nu, d->UC, nc);
+    if (d->ls != NULL)
+        local_search_update(old, g, d->ls, U, nu, d->UC, nc);
+
+    // Borrowed arrays are left untouched, a rebuilt graph is owned
+    if (d->uk > 0)
+    {
+        chils_api_free_graph(d);
+        d->g = g;
+        d->borrowed = 0;
+        d->borrowed_xadj = 0;
+        d->borrowed_weights = 0;
+    }
+    else
+    {
+        // Only the edges are still shared with old
+        if (g->V != old->V && (!d->borrowed || !d->borrowed_xadj))
+            free(old->V);
+        if (!d->borrowed || !d->borrowed_weights)
+            free(old->W);
+        if (g->V != old->V)
+            d->borrowed_xadj = 0;
+        free(old);
+        chils_api_free_derived(d);
+        d->g = g;
+        d->borrowed_weights = 0;
+    }
+
+    free(U);
+    d->uk = 0;
+    d->uc = 0;
+    d->un = 0;
+
+    // The stored solution belongs to the old graph
+    pthread_mutex_lock(&d->lock);
+    free(d->IS);
+    d->IS = NULL;
+    d->cost = 0;
+    d->size = 0;
+    d->time = 0.0;
+    d->upper_bound = LLONG_MAX;
+    pthread_mutex_unlock(&d->lock);
+#pragma omp critical(local_search_report)
+    {
+        d->control.best = 0;
+        d->control.time = 0.0;
+    }
+
+    if (d->c != NULL)
+        chils_api_store(d, d->c->cost, d->c->size, d->c->time, chils_get_best_independent_set(d->c));
+    if (d->ls != NULL)
+        chils_api_store(d, d->ls->cost, d->ls->size, d->ls->time, d->ls->independent_set);
+}
 
+static int chils_api_prepare(api_data *d)
+{
     if (d->g == NULL)
         chils_construct_graph(d);
 
+    chils_api_apply_updates(d);
+
+    if (d->validated)
+        return 1;
+
     if (!graph_validate(d->g))
     {
         fprintf(stderr, "Detected errors in the graph, make sure "
                         "there are no self edges or missing endpoints\n");
-        return;
+        return 0;
     }
 
-    if (d->ls == NULL)
-        d->ls = local_search_init(d->g, seed);
+    d->validated = 1;
+    return 1;
+}
+
+// Keep the stored solution current while chils_run is active
+static void chils_api_on_best(chils *c, void *data)
+{
+    chils_api_store((api_data *)data, c->cost, c->size, c->time, chils_get_best_independent_set(c));
+}
+
+static int chils_api_can_update(api_data *d)
+{
+    if (!chils_api_idle(d))
+        return 0;
+
+    if (d->g == NULL)
+        chils_construct_graph(d);
+
+    return 1;
+}
 
-    local_search_explore(d->g, d->ls, time_limit, LLONG_MAX, 0);
+static void chils_api_push_edge(api_data *d, int u, int v, int insert)
+{
+    if (!chils_api_can_update(d))
+        return;
 
-    if (d->cost < d->ls->cost || (d->cost == d->ls->cost && d->time > d->ls->time))
+    if (d->uk == d->_auk)
     {
-        d->cost = d->ls->cost;
-        d->size = d->ls->size;
-        d->time = d->ls->time;
-        d->IS = d->ls->independent_set;
+        d->_auk = d->_auk > 0 ? d->_auk * 2 : (1 << 10);
+        d->UX = realloc(d->UX, sizeof(int) * d->_auk);
+        d->UY = realloc(d->UY, sizeof(int) * d->_auk);
+        d->UD = realloc(d->UD, sizeof(int) * d->_auk);
     }
+
+    d->UX[d->uk] = u;
+    d->UY[d->uk] = v;
+    d->UD[d->uk] = insert;
+    d->uk++;
 }
 
-int chils_solution_get_size(void *solver)
+void chils_update_insert_edge(void *solver, int u, int v)
 {
-    api_data *d = (api_data *)solver;
+    chils_api_push_edge((api_data *)solver, u, v, 1);
+}
 
-    return d->size;
+void chils_update_delete_edge(void *solver, int u, int v)
+{
+    chils_api_push_edge((api_data *)solver, u, v, 0);
 }
 
-long long chils_solution_get_weight(void *solver)
+void chils_update_vertex_weight(void *solver, int u, long long weight)
 {
     api_data *d = (api_data *)solver;
 
-    return d->cost;
+    if (!chils_api_can_update(d))
+        return;
+
+    if (u < 0 || u >= d->g->n + d->un)
+    {
+        fprintf(stderr, "Invalid vertex %d in weight update\n", u);
+        return;
+    }
+
+    if (d->uc == d->_auc)
+    {
+        d->_auc = d->_auc > 0 ? d->_auc * 2 : (1 << 10);
+        d->UC = realloc(d->UC, sizeof(int) * d->_auc);
+        d->UW = realloc(d->UW, sizeof(long long) * d->_auc);
+    }
+
+    d->UC[d->uc] = u;
+    d->UW[d->uc] = weight;
+    d->uc++;
 }
 
-double chils_solution_get_time(void *solver)
+int chils_update_add_vertex(void *solver, long long weight)
 {
     api_data *d = (api_data *)solver;
 
-    return d->time;
+    if (!chils_api_can_update(d))
+        return -1;
+
+    if (d->g->n + d->un >= INT_MAX - 1)
+    {
+        fprintf(stderr, "Number of vertices must be less than %d\n", INT_MAX);
+        return -1;
+    }
+
+    d->un++;
+    chils_update_vertex_weight(solver, d->g->n + d->un - 1, weight);
+
+    return d->g->n + d->un - 1;
 }
 
-int chils_solution_get_vertex_configuration(void *solver, int u)
+static int *chils_api_push_initial(api_data *d, int slot)
+{
+    if (!chils_api_can_update(d))
+        return NULL;
+
+    int n = d->g->n + d->un, i = d->initial_count++;
+    d->initial = realloc(d->initial, sizeof(int *) * d->initial_count);
+    d->initial_slot = realloc(d->initial_slot, sizeof(int) * d->initial_count);
+    d->initial_n = realloc(d->initial_n, sizeof(int) * d->initial_count);
+
+    d->initial[i] = malloc(sizeof(int) * n);
+    d->initial_slot[i] = slot;
+    d->initial_n[i] = n;
+
+    return d->initial[i];
+}
+
+void chils_set_initial_solution(void *solver, int slot, const int *configuration)
 {
     api_data *d = (api_data *)solver;
 
-    if (d->IS == NULL || u < 0 || u >= d->g->n)
-        return 0;
+    int *I = chils_api_push_initial(d, slot);
+    if (I == NULL)
+        return;
+
+    int n = d->initial_n[d->initial_count - 1];
 
-    return d->IS[u];
+#pragma omp parallel for
+    for (int u = 0; u < n; u++)
+        I[u] = configuration[u] != 0;
 }
 
-int *chils_solution_get_independent_set(void *solver)
+void chils_set_initial_independent_set(void *solver, int slot, int size, const int *vertices)
 {
     api_data *d = (api_data *)solver;
 
-    if (d->IS == NULL)
-        return NULL;
+    int *I = chils_api_push_initial(d, slot);
+    if (I == NULL)
+        return;
+
+    int n = d->initial_n[d->initial_count - 1];
+
+#pragma omp parallel
+    {
+#pragma omp for
+        for (int u = 0; u < n; u++)
+            I[u] = 0;
+
+#pragma omp for
+        for (int i = 0; i < size; i++)
+        {
+            if (vertices[i] >= 0 && vertices[i] < n)
+                I[vertices[i]] = 1;
+            else
+                fprintf(stderr, "Invalid vertex %d in initial solution\n", vertices[i]);
+        }
+    }
+}
+
+/*
+    Move the waiting initial solutions into the p searches in LS. Vertices
+    added after a solution was given are left out of it.
+*/
+static void chils_api_apply_initial(api_data *d, local_search **LS, int p)
+{
+    if (d->initial_count == 0)
+        return;
+
+    int n = d->g->n;
+
+#pragma omp parallel
+    {
+        for (int i = 0; i < d->initial_count; i++)
+        {
+#pragma omp single
+            {
+                if (d->initial_n[i] < n)
+                {
+                    d->initial[i] = realloc(d->initial[i], sizeof(int) * n);
+                    for (int u = d->initial_n[i]; u < n; u++)
+                        d->initial[i][u] = 0;
+                }
+                if (d->initial_slot[i] >= p)
+                    fprintf(stderr, "Initial solution for slot %d ignored, there are only %d solutions\n",
+                            d->initial_slot[i], p);
+            }
+
+            for (int j = 0; j < p; j++)
+                if (d->initial_slot[i] == j || d->initial_slot[i] < 0)
+                    local_search_set_solution_par(d->g, LS[j], d->initial[i]);
+        }
+    }
+
+    for (int i = 0; i < d->initial_count; i++)
+        free(d->initial[i]);
+    d->initial_count = 0;
+}
+
+// The clique partition for the next run, NULL if disabled or if the graph has too few large cliques
+static const graph_cliques *chils_api_cliques(api_data *d)
+{
+    if (!d->use_cliques)
+        return NULL;
+
+    if (d->cliques == NULL && !d->cliques_tried)
+    {
+        d->cliques = graph_clique_partition(d->g);
+        d->cliques_tried = 1;
+    }
+    return d->cliques;
+}
+
+// The hubs for the next run, NULL if disabled, if the clique partition is used, or if there are none
+static const graph_hubs *chils_api_hubs(api_data *d)
+{
+    if (d->hub_degree < 1 || chils_api_cliques(d) != NULL)
+        return NULL;
+
+    if (d->hubs == NULL && !d->hubs_tried)
+    {
+        d->hubs = graph_hubs_init(d->g, d->hub_degree);
+        d->hubs_tried = 1;
+    }
+    return d->hubs;
+}
+
+// The interleaved adjacency for the next run, NULL if disabled or if the weights do not fit
+static const graph_neighbor *chils_api_neighbors(api_data *d)
+{
+    if (!d->use_interleave)
+        return NULL;
+
+    if (d->neighbors == NULL && !d->interleave_tried)
+    {
+        d->neighbors = graph_interleave(d->g);
+        d->interleave_tried = 1;
+    }
+    return d->neighbors;
+}
+
+static int chils_api_setup_full(api_data *d, int n_solutions, unsigned int seed)
+{
+    if (!chils_api_prepare(d))
+        return 0;
+
+    // Disjoint seeds for the solutions of each process
+    if (d->c == NULL && d->net != NULL)
+        seed += d->net->rank * 2 * n_solutions;
+
+    if (d->c == NULL)
+        d->c = chils_init(d->g, n_solutions, seed);
+    else if (n_solutions != d->c->p)
+        chils_resize(d->g, d->c, n_solutions);
+
+    d->c->max_depth = d->max_depth;
+    d->c->core_limit = d->min_core;
+    d->c->adaptive = d->adaptive;
+    d->c->step_work = d->step_work;
+    d->c->work_limit = d->work_limit;
+    d->c->fast_start = d->fast_start;
+    d->c->searches_per_thread = d->searches_per_thread;
+    d->c->cliques = chils_api_cliques(d);
+    d->c->hubs = chils_api_hubs(d);
+    d->c->neighbors = chils_api_neighbors(d);
+    d->c->gap_tolerance = d->gap_tolerance;
+    d->c->target_weight = d->target_weight;
+    d->c->stall_time = d->stall_time;
+    d->c->stall_iterations = d->stall_iterations;
+    d->c->checkpoint_path = d->checkpoint_path;
+    d->c->checkpoint_interval = d->checkpoint_interval;
+    d->c->net = d->net;
+    d->c->control = &d->control;
+    d->c->on_best = chils_api_on_best;
+    d->c->on_best_data = d;
+
+    chils_api_apply_initial(d, d->c->LS, d->c->p);
+
+    return 1;
+}
+
+static int chils_api_setup_local_search(api_data *d, unsigned int seed)
+{
+    if (!chils_api_prepare(d))
+        return 0;
+
+    if (d->ls == NULL)
+        d->ls = local_search_init(d->g, seed);
+
+    d->ls->control = &d->control;
+    d->ls->work_limit = d->work_limit;
+
+    const graph_cliques *cliques = chils_api_cliques(d);
+    if (d->ls->cliques != cliques)
+        local_search_set_cliques(d->g, d->ls, cliques);
+
+    const graph_hubs *hubs = chils_api_hubs(d);
+    if (d->ls->hubs != hubs)
+        local_search_set_hubs(d->g, d->ls, hubs);
+    d->ls->neighbors = chils_api_neighbors(d);
+    d->ls->stall_time = d->stall_time;
+    d->ls->stall_iterations = d->stall_iterations;
+
+    chils_api_apply_initial(d, &d->ls, 1);
+
+    return 1;
+}
+
+static void chils_api_store_full(api_data *d)
+{
+    // The exchange gives up on lost connections
+    if (d->c->net == NULL)
+    {
+        chils_net_free(d->net);
+        d->net = NULL;
+    }
+
+    chils_api_store(d, d->c->cost, d->c->size, d->c->time, chils_get_best_independent_set(d->c));
+
+    long long upper_bound;
+#pragma omp atomic read
+    upper_bound = d->c->upper_bound;
+
+    pthread_mutex_lock(&d->lock);
+    d->upper_bound = upper_bound;
+    d->target_time = d->c->target_time;
+    pthread_mutex_unlock(&d->lock);
+}
+
+static void chils_api_store_local_search(api_data *d)
+{
+    chils_api_store(d, d->ls->cost, d->ls->size, d->ls->time, d->ls->independent_set);
+
+    if (d->ls->cost >= d->ls->stop_weight)
+    {
+        pthread_mutex_lock(&d->lock);
+        if (d->target_time < 0.0)
+            d->target_time = d->ls->time;
+        pthread_mutex_unlock(&d->lock);
+    }
+}
+
+static int chils_api_begin(api_data *d)
+{
+    if (d->running)
+    {
+        fprintf(stderr, "The solver is already running, use chils_wait first\n");
+        return 0;
+    }
+
+    d->call_start = omp_get_wtime();
+
+    pthread_mutex_lock(&d->lock);
+    d->target_time = -1.0;
+    pthread_mutex_unlock(&d->lock);
+
+#pragma omp atomic write
+    d->control.stop = 0;
+#pragma omp critical(local_search_report)
+    {
+        d->control.best = d->cost;
+        d->control.time = d->time;
+    }
+    return 1;
+}
+
+// Set the deadline of a run after setup, and return the time left
+static double chils_api_time_left(api_data *d, double time_limit)
+{
+    double now = omp_get_wtime();
+    d->deadline = (d->total_time ? d->call_start : now) + time_limit;
+
+    return d->deadline > now ? d->deadline - now : 0.0;
+}
+
+// Compute the bound if the gap tolerance needs it, after the deadline is set so it counts against the run,
+// and return the time left
+static double chils_api_local_search_bound(api_data *d, double remaining)
+{
+    if (d->gap_tolerance > 0.0 && d->upper_bound == LLONG_MAX)
+    {
+        long long upper_bound = graph_clique_cover(d->g, NULL);
+        pthread_mutex_lock(&d->lock);
+        d->upper_bound = upper_bound;
+        pthread_mutex_unlock(&d->lock);
+
+        double now = omp_get_wtime();
+        remaining = d->deadline > now ? d->deadline - now : 0.0;
+    }
+
+    d->ls->stop_weight = d->upper_bound - (long long)(d->upper_bound * d->gap_tolerance);
+    if (d->target_weight < d->ls->stop_weight)
+        d->ls->stop_weight = d->target_weight;
+
+    return remaining;
+}
+
+// Record how late a run stopped, for runs that reached the deadline
+static void chils_api_finish(api_data *d)
+{
+    double overshoot = omp_get_wtime() - d->deadline;
+    if (overshoot < 0.0)
+        return;
+
+    pthread_mutex_lock(&d->lock);
+    d->overshoot_count++;
+    d->overshoot_last = overshoot;
+    d->overshoot_sum += overshoot;
+    if (overshoot > d->overshoot_max)
+        d->overshoot_max = overshoot;
+    pthread_mutex_unlock(&d->lock);
+}
+
+void chils_run_full(void *solver, double time_limit, int n_solutions, unsigned int seed)
+{
+    api_data *d = (api_data *)solver;
+
+    if (!chils_api_begin(d) || !chils_api_setup_full(d, n_solutions, seed))
+        return;
+
+    chils_run(d->g, d->c, chils_api_time_left(d, time_limit), LLONG_MAX, 0);
+    chils_api_finish(d);
+
+    chils_api_store_full(d);
+}
+
+void chils_set_total_time(void *solver, int enabled)
+{
+    api_data *d = (api_data *)solver;
+
+    d->total_time = enabled;
+}
+
+long long chils_get_overshoot(void *solver, double *last, double *max, double *mean)
+{
+    api_data *d = (api_data *)solver;
+
+    pthread_mutex_lock(&d->lock);
+    long long count = d->overshoot_count;
+    if (last != NULL)
+        *last = d->overshoot_last;
+    if (max != NULL)
+        *max = d->overshoot_max;
+    if (mean != NULL)
+        *mean = count > 0 ? d->overshoot_sum / count : 0.0;
+    pthread_mutex_unlock(&d->lock);
+
+    return count;
+}
+
+void chils_set_work_limit(void *solver, long long work_limit, long long step_work)
+{
+    api_data *d = (api_data *)solver;
+
+    d->work_limit = work_limit > 0 ? work_limit : LLONG_MAX;
+    d->step_work = step_work > 0 ? step_work : LLONG_MAX;
+    if (d->work_limit < LLONG_MAX && d->step_work == LLONG_MAX)
+        d->step_work = DEFAULT_STEP_WORK;
+}
+
+void chils_set_gap_tolerance(void *solver, double gap)
+{
+    api_data *d = (api_data *)solver;
+
+    d->gap_tolerance = gap > 0.0 ? gap : 0.0;
+}
+
+long long chils_get_upper_bound(void *solver)
+{
+    api_data *d = (api_data *)solver;
+
+    pthread_mutex_lock(&d->lock);
+    long long upper_bound = d->upper_bound;
+    pthread_mutex_unlock(&d->lock);
+
+    // The bound may have been found after the last run ended
+    if (upper_bound == LLONG_MAX && d->c != NULL)
+    {
+#pragma omp atomic read
+        upper_bound = d->c->upper_bound;
+    }
+
+    return upper_bound < LLONG_MAX ? upper_bound : -1;
+}
+
+void chils_set_target_weight(void *solver, long long weight)
+{
+    api_data *d = (api_data *)solver;
+
+    d->target_weight = weight > 0 ? weight : LLONG_MAX;
+}
+
+void chils_set_stagnation(void *solver, double seconds, long long iterations)
+{
+    api_data *d = (api_data *)solver;
+
+    d->stall_time = seconds > 0.0 ? seconds : INFINITY;
+    d->stall_iterations = iterations > 0 ? iterations : LLONG_MAX;
+}
+
+double chils_get_time_to_target(void *solver)
+{
+    api_data *d = (api_data *)solver;
+
+    pthread_mutex_lock(&d->lock);
+    double target_time = d->target_time;
+    pthread_mutex_unlock(&d->lock);
+
+    return target_time;
+}
+
+void chils_set_clique_partition(void *solver, int enabled)
+{
+    api_data *d = (api_data *)solver;
+
+    d->use_cliques = enabled != 0;
+}
+
+void chils_set_interleaved_adjacency(void *solver, int enabled)
+{
+    api_data *d = (api_data *)solver;
+
+    d->use_interleave = enabled != 0;
+}
+
+void chils_set_hub_degree(void *solver, int min_degree)
+{
+    api_data *d = (api_data *)solver;
+
+    // The searches of a background run read the hubs
+    if (!chils_api_idle(d))
+        return;
+
+    if (min_degree < 0)
+        min_degree = 0;
+    if (min_degree == d->hub_degree)
+        return;
+
+    // The searches let go of the old hubs before they are freed
+    if (d->hubs != NULL)
+    {
+        if (d->ls != NULL)
+            local_search_set_hubs(d->g, d->ls, NULL);
+        if (d->c != NULL)
+        {
+            d->c->hubs = NULL;
+            for (int i = 0; i < d->c->p; i++)
+                local_search_set_hubs(d->g, d->c->LS[i], NULL);
+        }
+        graph_hubs_free(d->hubs);
+        d->hubs = NULL;
+    }
+
+    d->hub_degree = min_degree;
+    d->hubs_tried = 0;
+}
+
+void chils_set_fast_start(void *solver, int enabled)
+{
+    api_data *d = (api_data *)solver;
+
+    d->fast_start = enabled != 0;
+}
+
+void chils_set_searches_per_thread(void *solver, int count)
+{
+    api_data *d = (api_data *)solver;
+
+    if (count < 1)
+        count = 1;
+    d->searches_per_thread = count < CHILS_MAX_INTERLEAVE ? count : CHILS_MAX_INTERLEAVE;
+}
+
+void chils_set_recursion(void *solver, int max_depth, int min_core)
+{
+    api_data *d = (api_data *)solver;
+
+    d->max_depth = max_depth;
+    d->min_core = min_core;
+}
+
+void chils_set_adaptive(void *solver, int enabled)
+{
+    api_data *d = (api_data *)solver;
+
+    d->adaptive = enabled;
+}
+
+void chils_set_checkpoint(void *solver, const char *path, double interval)
+{
+    api_data *d = (api_data *)solver;
+
+    if (!chils_api_idle(d))
+        return;
+
+    free(d->checkpoint_path);
+    d->checkpoint_path = NULL;
+    if (path != NULL)
+    {
+        d->checkpoint_path = malloc(strlen(path) + 1);
+        strcpy(d->checkpoint_path, path);
+    }
+    d->checkpoint_interval = interval;
+
+    if (d->c != NULL)
+    {
+        d->c->checkpoint_path = d->checkpoint_path;
+        d->c->checkpoint_interval = d->checkpoint_interval;
+    }
+}
+
+int chils_set_distributed(void *solver, const char *address, int rank, int size)
+{
+    api_data *d = (api_data *)solver;
+
+    if (!chils_api_idle(d))
+        return 0;
+
+    chils_net_free(d->net);
+    d->net = chils_net_init(address, rank, size);
+
+    return d->net != NULL;
+}
+
+int chils_resume(void *solver, const char *path)
+{
+    api_data *d = (api_data *)solver;
+
+    if (!chils_api_idle(d) || !chils_api_prepare(d))
+        return 0;
+
+    if (d->c == NULL)
+        d->c = chils_init(d->g, 1, 0);
+
+    if (!chils_checkpoint_load(d->g, d->c, path))
+        return 0;
+
+    chils_api_store(d, d->c->cost, d->c->size, d->c->time, chils_get_best_independent_set(d->c));
+
+    return 1;
+}
+
+void chils_run_local_search_only(void *solver, double time_limit, unsigned int seed)
+{
+    api_data *d = (api_data *)solver;
+
+    if (!chils_api_begin(d) || !chils_api_setup_local_search(d, seed))
+        return;
+
+    double remaining = chils_api_local_search_bound(d, chils_api_time_left(d, time_limit));
+    local_search_explore(d->g, d->ls, remaining, LLONG_MAX, 0);
+    chils_api_finish(d);
+
+    chils_api_store_local_search(d);
+}
+
+static int chils_api_cancelled(api_data *d)
+{
+    int stop;
+#pragma omp atomic read
+    stop = d->control.stop;
+
+    return stop;
+}
+
+static void *chils_api_worker(void *arg)
+{
+    api_data *d = (api_data *)arg;
+
+    int ok = d->async_full ? chils_api_setup_full(d, d->async_n, d->async_seed)
+                           : chils_api_setup_local_search(d, d->async_seed);
+
+    double remaining = chils_api_time_left(d, d->async_time_limit);
+    if (ok && d->async_full)
+    {
+        // The stored solution is refreshed through on_best during the run
+        chils_run(d->g, d->c, remaining, LLONG_MAX, 0);
+        chils_api_store_full(d);
+    }
+    else if (ok)
+    {
+        remaining = chils_api_local_search_bound(d, remaining);
+
+        // Short slices to refresh the stored solution, the stall limits carry over between slices
+        long long work_start = d->ls->work, stalled = 0, cost = d->ls->cost;
+        double improved = omp_get_wtime();
+        while (remaining > 0.0 && !chils_api_cancelled(d) && d->ls->cost < d->ls->stop_weight &&
+               stalled < d->stall_iterations && omp_get_wtime() - improved < d->stall_time)
+        {
+            if (d->work_limit < LLONG_MAX)
+            {
+                d->ls->work_limit = d->work_limit - (d->ls->work - work_start);
+                if (d->ls->work_limit <= 0)
+                    break;
+            }
+            d->ls->stall_iterations = d->stall_iterations - stalled;
+            d->ls->stall_time = d->stall_time - (omp_get_wtime() - improved);
+
+            local_search_explore(d->g, d->ls, remaining < ASYNC_SLICE ? remaining : ASYNC_SLICE, LLONG_MAX, 0);
+            chils_api_store_local_search(d);
+
+            if (d->ls->cost > cost)
+            {
+                cost = d->ls->cost;
+                stalled = d->ls->stalled;
+                improved = d->ls->time_ref + d->ls->time;
+            }
+            else
+                stalled += d->ls->stalled;
+            remaining = d->deadline - omp_get_wtime();
+        }
+    }
+
+    if (ok)
+        chils_api_finish(d);
+
+#pragma omp atomic write
+    d->active = 0;
+
+    return NULL;
+}
+
+static int chils_api_start(api_data *d)
+{
+    d->active = 1;
+    if (pthread_create(&d->thread, NULL, chils_api_worker, d) != 0)
+    {
+        fprintf(stderr, "Unable to start the solver thread\n");
+        d->active = 0;
+        return 0;
+    }
+    d->running = 1;
+    return 1;
+}
+
+int chils_start_full(void *solver, double time_limit, int n_solutions, unsigned int seed)
+{
+    api_data *d = (api_data *)solver;
+
+    if (!chils_api_begin(d))
+        return 0;
+
+    d->async_full = 1;
+    d->async_n = n_solutions;
+    d->async_seed = seed;
+    d->async_time_limit = time_limit;
+
+    return chils_api_start(d);
+}
+
+int chils_start_local_search_only(void *solver, double time_limit, unsigned int seed)
+{
+    api_data *d = (api_data *)solver;
+
+    if (!chils_api_begin(d))
+        return 0;
+
+    d->async_full = 0;
+    d->async_seed = seed;
+    d->async_time_limit = time_limit;
+
+    return chils_api_start(d);
+}
+
+int chils_poll(void *solver, long long *weight, double *time)
+{
+    api_data *d = (api_data *)solver;
+
+#pragma omp critical(local_search_report)
+    {
+        if (weight != NULL)
+            *weight = d->control.best;
+        if (time != NULL)
+            *time = d->control.time;
+    }
+
+    int active;
+#pragma omp atomic read
+    active = d->active;
+
+    return active;
+}
+
+void chils_wait(void *solver)
+{
+    api_data *d = (api_data *)solver;
+
+    if (!d->running)
+        return;
+
+    pthread_join(d->thread, NULL);
+    d->running = 0;
+}
+
+void chils_cancel(void *solver)
+{
+    api_data *d = (api_data *)solver;
+
+#pragma omp atomic write
+    d->control.stop = 1;
+}
+
+void chils_set_callback(void *solver, void (*callback)(long long weight, double time, void *data), void *data)
+{
+    api_data *d = (api_data *)solver;
+
+#pragma omp critical(local_search_report)
+    {
+        d->control.callback = callback;
+        d->control.data = data;
+    }
+}
+
+void chils_solve_batch(int count, const int *n, const long long *const *xadj, const int *const *adjncy,
+                       const long long *const *weights, const double *time_limit, const long long *iteration_limit,
+                       unsigned int seed, int *const *solutions, long long *solution_weights)
+{
+#pragma omp parallel
+    {
+        // One search per thread, reused and grown to fit each instance
+        local_search *ls = NULL;
+        int capacity = 0;
+
+#pragma omp for schedule(dynamic, 1)
+        for (int i = 0; i < count; i++)
+        {
+            graph g = {.n = n[i], .m = xadj[i][n[i]], .V = (long long *)xadj[i],
+                       .E = (int *)adjncy[i], .W = (long long *)weights[i]};
+
+            if (ls == NULL)
+            {
+                ls = local_search_init(&g, seed + i);
+                capacity = g.n;
+            }
+            else
+            {
+                local_search_grow(ls, capacity, g.n);
+                if (g.n > capacity)
+                    capacity = g.n;
+
+                ls->seed = seed + i;
+                local_search_reset(&g, ls);
+            }
+
+            if (g.n > 0)
+                local_search_explore(&g, ls, time_limit[i],
+                                     iteration_limit != NULL ? iteration_limit[i] : LLONG_MAX, 0);
+
+            for (int u = 0; u < g.n; u++)
+                solutions[i][u] = ls->independent_set[u];
+            if (solution_weights != NULL)
+                solution_weights[i] = ls->cost;
+        }
+
+        local_search_free(ls);
+    }
+}
+
+int chils_solution_get_size(void *solver)
+{
+    api_data *d = (api_data *)solver;
+
+    pthread_mutex_lock(&d->lock);
+    int size = d->size;
+    pthread_mutex_unlock(&d->lock);
+
+    return size;
+}
+
+long long chils_solution_get_weight(void *solver)
+{
+    api_data *d = (api_data *)solver;
+
+    pthread_mutex_lock(&d->lock);
+    long long cost = d->cost;
+    pthread_mutex_unlock(&d->lock);
+
+    return cost;
+}
+
+double chils_solution_get_time(void *solver)
+{
+    api_data *d = (api_data *)solver;
+
+    pthread_mutex_lock(&d->lock);
+    double time = d->time;
+    pthread_mutex_unlock(&d->lock);
+
+    return time;
+}
+
+int chils_solution_get_vertex_configuration(void *solver, int u)
+{
+    api_data *d = (api_data *)solver;
+
+    pthread_mutex_lock(&d->lock);
+    int res = d->IS != NULL && u >= 0 && u < d->g->n && d->IS[u];
+    pthread_mutex_unlock(&d->lock);
+
+    return res;
+}
+
+int *chils_solution_get_independent_set(void *solver)
+{
+    api_data *d = (api_data *)solver;
+
+    pthread_mutex_lock(&d->lock);
+    if (d->IS == NULL)
+    {
+        pthread_mutex_unlock(&d->lock);
+        return NULL;
+    }
 
     int *res = malloc(sizeof(int) * d->size);
 
@@ -299,6 +1758,7 @@ int *chils_solution_get_independent_set(void *solver)
     for (int i = 0; i < d->g->n; i++)
         if (d->IS[i])
             res[p++] = i;
+    pthread_mutex_unlock(&d->lock);
 
     return res;
 }
\ No newline at end of file
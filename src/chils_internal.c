@@ -1,28 +1,97 @@
 #include <omp.h>
 #include <limits.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
 
 #include "chils_internal.h"
+#include "exact.h"
 
 #define MIN_CORE 512
 #define DEFAULT_STEP_TIME 10.0
 #define DEFAULT_STEP_COUNT LLONG_MAX
+#define DEFAULT_CORE_LIMIT (1 << 16)
+#define RECURSIVE_STEPS 4
+#define EXACT_NODE_LIMIT (1 << 14)
+#define EXACT_CORE 64
+#define START_PERTURBE 1
+
+// Adaptive step time, durations are relative to step_time
+#define ADAPT_INITIAL 0.1
+#define ADAPT_MAX 4.0
+#define ADAPT_MIN_TIME 0.01
+#define ADAPT_GROW 1.5
+#define ADAPT_SHRINK 0.5
+#define ADAPT_CORE_SCALE 4.0
+
+#define CHECKPOINT_MAGIC "CHILSCK1"
+#define DEFAULT_CHECKPOINT_INTERVAL 60.0
 
 chils *chils_init(graph *g, int p, unsigned int seed)
 {
     chils *c = malloc(sizeof(chils));
 
     c->p = p;
+    c->seed = seed;
     c->step_time = DEFAULT_STEP_TIME;
     c->step_count = DEFAULT_STEP_COUNT;
+    c->step_work = LLONG_MAX;
+    c->work_limit = LLONG_MAX;
+    c->core_build_time = 0.0;
+    c->fast_start = 0;
+    c->searches_per_thread = 1;
+    c->cliques = NULL;
+    c->hubs = NULL;
+    c->neighbors = NULL;
+    c->upper_bound = LLONG_MAX;
+    c->gap_tolerance = 0.0;
+    c->cover_graph = NULL;
+    c->cover_running = 0;
+    c->cover_done = 0;
+    c->cover_stop = 0;
+    c->target_weight = LLONG_MAX;
+    c->stall_iterations = LLONG_MAX;
+    c->stall_time = INFINITY;
+    c->target_time = -1.0;
 
     c->cost = 0;
     c->size = 0;
     c->time = 0.0;
 
+    c->depth = 0;
+    c->max_depth = 0;
+    c->core_limit = DEFAULT_CORE_LIMIT;
+    c->sub = NULL;
+
+    c->adaptive = 0;
+    c->full_time = malloc(sizeof(double) * p);
+    c->core_time = malloc(sizeof(double) * p);
+    for (int i = 0; i < p; i++)
+    {
+        c->full_time[i] = 0.0;
+        c->core_time[i] = 0.0;
+    }
+
+    c->it = 0;
+    c->checkpoint_path = NULL;
+    c->checkpoint_interval = DEFAULT_CHECKPOINT_INTERVAL;
+    c->checkpoint_last = omp_get_wtime();
+    c->checkpoint_header.p = 0;
+    c->checkpoint_entries = NULL;
+    c->checkpoint_bits = NULL;
+
+    c->net = NULL;
+    c->net_bits = NULL;
+
+    c->control = NULL;
+    c->on_best = NULL;
+    c->on_best_data = NULL;
+
     c->LS = malloc(sizeof(local_search *) * p);
     c->LS_core = malloc(sizeof(local_search *) * p);
 
+    // Only touched once a D-core is built, FM and RM are written before use
     c->d_core = malloc(sizeof(graph));
     c->d_core->n = 0;
     c->d_core->m = 0;
@@ -36,24 +105,32 @@ chils *chils_init(graph *g, int p, unsigned int seed)
     c->A = malloc(sizeof(int) * g->n);
 
     int nt;
-#pragma omp parallel
+    if (omp_in_parallel())
     {
-#pragma omp master
+        nt = omp_get_num_threads();
+    }
+    else
+    {
+#pragma omp parallel
         {
-            nt = omp_get_num_threads();
+#pragma omp master
+            {
+                nt = omp_get_num_threads();
+            }
         }
     }
 
+    c->nt = nt;
     c->S1 = malloc(sizeof(long long) * nt);
     c->S2 = malloc(sizeof(long long) * nt);
 
 #pragma omp parallel
     {
-#pragma omp for
+#pragma omp for schedule(dynamic, 1)
         for (int i = 0; i < p; i++)
         {
-            c->LS[i] = local_search_init(g, seed + i);
-            c->LS_core[i] = local_search_init(g, seed + p + i);
+            c->LS[i] = local_search_init_lazy(g, seed + i);
+            c->LS_core[i] = NULL;
         }
 #pragma omp for
         for (int i = 0; i < nt; i++)
@@ -61,23 +138,77 @@ chils *chils_init(graph *g, int p, unsigned int seed)
             c->S1[i] = 0;
             c->S2[i] = 0;
         }
-#pragma omp for
-        for (int i = 0; i < g->n; i++)
-        {
-            c->FM[i] = -1;
-            c->RM[i] = -1;
-            c->A[i] = 0;
-        }
     }
 
     return c;
 }
 
+static void *chils_cover_worker(void *arg)
+{
+    chils *c = (chils *)arg;
+
+    long long upper_bound = graph_clique_cover(c->cover_graph, &c->cover_stop);
+    if (upper_bound < LLONG_MAX)
+    {
+#pragma omp atomic write
+        c->upper_bound = upper_bound;
+    }
+
+#pragma omp atomic write
+    c->cover_done = 1;
+
+    return NULL;
+}
+
+// Start computing the upper bound next to the search, unless it is known or still being computed
+static void chils_cover_start(graph *g, chils *c)
+{
+    if (c->depth > 0)
+        return;
+
+    if (c->cover_running)
+    {
+        int done;
+#pragma omp atomic read
+        done = c->cover_done;
+        if (!done)
+            return;
+        pthread_join(c->cover_thread, NULL);
+        c->cover_running = 0;
+    }
+
+    long long upper_bound;
+#pragma omp atomic read
+    upper_bound = c->upper_bound;
+    if (upper_bound < LLONG_MAX)
+        return;
+
+    c->cover_graph = g;
+    c->cover_done = 0;
+    c->cover_stop = 0;
+    c->cover_running = pthread_create(&c->cover_thread, NULL, chils_cover_worker, c) == 0;
+}
+
+// Stop the helper before the graph it reads changes or goes away
+static void chils_cover_stop(chils *c)
+{
+    if (!c->cover_running)
+        return;
+
+#pragma omp atomic write
+    c->cover_stop = 1;
+    pthread_join(c->cover_thread, NULL);
+    c->cover_running = 0;
+}
+
 void chils_free(chils *c)
 {
     if (c == NULL)
         return;
 
+    chils_cover_stop(c);
+
+    chils_free(c->sub);
     graph_free(c->d_core);
 
     for (int i = 0; i < c->p; i++)
@@ -89,6 +220,13 @@ void chils_free(chils *c)
     free(c->LS);
     free(c->LS_core);
 
+    free(c->full_time);
+    free(c->core_time);
+
+    free(c->checkpoint_entries);
+    free(c->checkpoint_bits);
+    free(c->net_bits);
+
     free(c->FM);
     free(c->RM);
     free(c->A);
@@ -98,6 +236,107 @@ void chils_free(chils *c)
     free(c);
 }
 
+static inline int chils_better(chils *c, int i, int j)
+{
+    return c->LS[i]->cost > c->LS[j]->cost ||
+           (c->LS[i]->cost == c->LS[j]->cost && c->LS[i]->time < c->LS[j]->time) ||
+           (c->LS[i]->cost == c->LS[j]->cost && c->LS[i]->time == c->LS[j]->time && i < j);
+}
+
+void chils_resize(graph *g, chils *c, int p)
+{
+    if (p < 1 || p == c->p)
+        return;
+
+    int old_p = c->p;
+
+    // Rank the current solutions, best first
+    int *order = malloc(sizeof(int) * old_p);
+    for (int i = 0; i < old_p; i++)
+    {
+        int j = i;
+        while (j > 0 && chils_better(c, i, order[j - 1]))
+        {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    if (p < old_p)
+    {
+        // Keep the p best solutions, in their original order
+        int *keep = malloc(sizeof(int) * old_p);
+        for (int i = 0; i < old_p; i++)
+            keep[i] = 0;
+        for (int i = 0; i < p; i++)
+            keep[order[i]] = 1;
+
+        int k = 0;
+        for (int i = 0; i < old_p; i++)
+        {
+            if (!keep[i])
+            {
+                local_search_free(c->LS[i]);
+                local_search_free(c->LS_core[i]);
+                continue;
+            }
+            c->LS[k] = c->LS[i];
+            c->LS_core[k] = c->LS_core[i];
+            c->full_time[k] = c->full_time[i];
+            c->core_time[k] = c->core_time[i];
+            k++;
+        }
+        free(keep);
+    }
+
+    c->LS = realloc(c->LS, sizeof(local_search *) * p);
+    c->LS_core = realloc(c->LS_core, sizeof(local_search *) * p);
+    c->full_time = realloc(c->full_time, sizeof(double) * p);
+    c->core_time = realloc(c->core_time, sizeof(double) * p);
+
+    if (p > old_p)
+    {
+        // New members start from the current best solutions, round robin
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int i = old_p; i < p; i++)
+        {
+            local_search *src = c->LS[order[(i - old_p) % old_p]];
+
+            c->LS[i] = local_search_init(g, c->seed + 2 * p + i);
+            c->LS_core[i] = NULL;
+            c->LS[i]->max_queue = src->max_queue;
+
+            for (int u = 0; u < g->n; u++)
+                if (src->independent_set[u])
+                    local_search_add_vertex(g, c->LS[i], u);
+
+            c->LS[i]->time = src->time;
+            c->LS[i]->time_ref = src->time_ref;
+            c->full_time[i] = c->full_time[order[(i - old_p) % old_p]];
+            c->core_time[i] = c->core_time[order[(i - old_p) % old_p]];
+        }
+    }
+
+    free(order);
+
+    // The nested level is recreated with the new pool size when needed
+    chils_free(c->sub);
+    c->sub = NULL;
+
+    c->p = p;
+}
+
+static inline void chils_reserve_threads(chils *c, int nt)
+{
+    if (nt <= c->nt)
+        return;
+
+    c->nt = nt;
+    c->S1 = realloc(c->S1, sizeof(long long) * nt);
+    c->S2 = realloc(c->S2, sizeof(long long) * nt);
+}
+
 static inline int chils_find_overall_best(chils *c)
 {
     int best = 0;
@@ -126,13 +365,36 @@ static inline int chils_find_first_worst(chils *c)
     return worst;
 }
 
+long long chils_target(chils *c)
+{
+    long long upper_bound;
+#pragma omp atomic read
+    upper_bound = c->upper_bound;
+
+    if (c->depth > 0)
+        return LLONG_MAX;
+    if (upper_bound == LLONG_MAX)
+        return c->target_weight;
+
+    long long target = upper_bound - (long long)(upper_bound * c->gap_tolerance);
+    return target < c->target_weight ? target : c->target_weight;
+}
+
 void chils_print(chils *c, long long it, double elapsed)
 {
     int best = chils_find_overall_best(c), worst = chils_find_first_worst(c);
+    long long upper_bound;
+#pragma omp atomic read
+    upper_bound = c->upper_bound;
+
     printf("\r%6lld: %12lld (%3d %8.2lf) %12lld (%3d %8.2lf) %8.2lf %9d %12lld",
            it, c->LS[best]->cost, best, c->LS[best]->time,
            c->LS[worst]->cost, worst, c->LS[worst]->time,
            elapsed, c->d_core->n, c->d_core->m);
+    if (upper_bound < LLONG_MAX && upper_bound > 0)
+        printf(" %7.3lf%%", 100.0 * (upper_bound - c->LS[best]->cost) / upper_bound);
+    else
+        printf(" %8s", "-");
     fflush(stdout);
 }
 
@@ -142,82 +404,778 @@ void chils_update_best(chils *c)
     c->cost = c->LS[best]->cost;
     c->size = c->LS[best]->size;
     c->time = c->LS[best]->time;
+
+    if (c->depth == 0)
+    {
+        local_search_report(c->LS[best]);
+        if (c->on_best != NULL)
+            c->on_best(c, c->on_best_data);
+    }
 }
 
-void chils_run(graph *g, chils *c, double tl, long long cl, int verbose)
+void chils_update(graph *old, graph *g, chils *c, const int *U, long long nu, const int *C, long long nc)
 {
-    double start = omp_get_wtime();
-    double end = omp_get_wtime();
-    double elapsed = end - start;
+    chils_cover_stop(c);
 
-    if (verbose)
+    c->cliques = NULL;
+    c->hubs = NULL;
+    c->neighbors = NULL;
+
+    if (g->n > old->n || g->m > old->m)
     {
-        if (cl < LLONG_MAX)
-            printf("Running chils for %.2lf seconds or %lld iterations\n", tl, cl);
-        else
-            printf("Running chils for %.2lf seconds\n", tl);
-        printf("%7s %12s (%3s %8s) %12s (%3s %8s) %8s %9s %12s\n", "It.",
-               "Best WIS", "id", "time",
-               "Worst WIS", "id", "time",
-               "time", "D-Core V", "D-Core E");
-        chils_print(c, 0, elapsed);
+        c->d_core->V = realloc(c->d_core->V, sizeof(long long) * (g->n + 1));
+        c->d_core->E = realloc(c->d_core->E, sizeof(int) * g->m);
+        c->d_core->W = realloc(c->d_core->W, sizeof(long long) * g->n);
     }
 
+    if (g->n > old->n)
+    {
+        c->FM = realloc(c->FM, sizeof(int) * g->n);
+        c->RM = realloc(c->RM, sizeof(int) * g->n);
+        c->A = realloc(c->A, sizeof(int) * g->n);
+
+        // Sized by the number of vertices, reallocated on next use
+        c->checkpoint_header.p = 0;
+        free(c->net_bits);
+        c->net_bits = NULL;
+    }
+
+    // The nested level is recreated for the new D-core when needed
+    chils_free(c->sub);
+    c->sub = NULL;
+    c->upper_bound = LLONG_MAX;
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < c->p; i++)
+    {
+        local_search_update(old, g, c->LS[i], U, nu, C, nc);
+        if (c->LS_core[i] != NULL)
+            local_search_grow(c->LS_core[i], old->n, g->n);
+    }
+
+    int best = chils_find_overall_best(c);
+    c->cost = c->LS[best]->cost;
+    c->size = c->LS[best]->size;
+    c->time = c->LS[best]->time;
+}
+
+static inline double chils_clamp_time(chils *c, double duration)
+{
+    if (duration > c->step_time * ADAPT_MAX)
+        duration = c->step_time * ADAPT_MAX;
+    if (duration < ADAPT_MIN_TIME)
+        duration = ADAPT_MIN_TIME;
+    return duration;
+}
+
+static inline int chils_deterministic(chils *c)
+{
+    return c->step_work < LLONG_MAX;
+}
+
+static inline double chils_full_duration(chils *c, int i)
+{
+    if (chils_deterministic(c))
+        return INFINITY;
+    if (!c->adaptive)
+        return c->step_time;
+
+    if (c->full_time[i] <= 0.0)
+    {
+        c->full_time[i] = chils_clamp_time(c, c->step_time * ADAPT_INITIAL);
+        c->core_time[i] = chils_clamp_time(c, c->full_time[i] * 0.5);
+    }
+    return c->full_time[i];
+}
+
+static inline double chils_core_duration(graph *g, chils *c, int i)
+{
+    if (chils_deterministic(c))
+        return INFINITY;
+    if (!c->adaptive)
+        return c->step_time * 0.5;
+
+    // A small D-core converges faster, so it gets a smaller share of the full slice
+    double share = ADAPT_CORE_SCALE * ((double)c->d_core->n / (double)g->n);
+    if (share > 1.0)
+        share = 1.0;
+
+    double duration = c->core_time[i];
+    if (duration > chils_full_duration(c, i) * share)
+        duration = chils_full_duration(c, i) * share;
+    if (duration < ADAPT_MIN_TIME)
+        duration = ADAPT_MIN_TIME;
+    return duration;
+}
+
+/*
+    Lengthen the slice if ls improved during the last half of it,
+    shorten it if ls did not improve at all.
+*/
+static inline double chils_adapt(chils *c, double duration, double slice_start, local_search *ls, long long before)
+{
+    double slice = omp_get_wtime() - slice_start;
+    if (ls->cost <= before)
+        duration *= ADAPT_SHRINK;
+    else if (ls->time_ref + ls->time - slice_start > slice * 0.5)
+        duration *= ADAPT_GROW;
+    return chils_clamp_time(c, duration);
+}
+
+static inline size_t chils_checkpoint_row(graph *g)
+{
+    return ((size_t)g->n + 7) / 8;
+}
+
+// Should be called inside parallel region
+static void chils_checkpoint_snapshot(graph *g, chils *c)
+{
+    size_t row = chils_checkpoint_row(g);
+
+#pragma omp single
+    {
+        if (c->checkpoint_header.p != c->p)
+        {
+            c->checkpoint_entries = realloc(c->checkpoint_entries, sizeof(chils_checkpoint_entry) * c->p);
+            c->checkpoint_bits = realloc(c->checkpoint_bits, row * c->p);
+        }
+        c->checkpoint_last = omp_get_wtime();
+        c->checkpoint_header = (chils_checkpoint_header){.n = g->n, .p = c->p, .size = c->size, .seed = c->seed,
+                                                         .m = g->m, .it = c->it, .cost = c->cost,
+                                                         .time = c->time};
+    }
+
+#pragma omp for schedule(dynamic, 1)
+    for (int i = 0; i < c->p; i++)
+    {
+        local_search *ls = c->LS[i];
+        c->checkpoint_entries[i] = (chils_checkpoint_entry){.seed = ls->seed, .size = ls->size,
+                                                            .max_queue = ls->max_queue, .cost = ls->cost,
+                                                            .time = ls->time, .age = c->checkpoint_last - ls->time_ref,
+                                                            .full_time = c->full_time[i], .core_time = c->core_time[i]};
+
+        unsigned char *bits = c->checkpoint_bits + row * i;
+        for (size_t b = 0; b < row; b++)
+            bits[b] = 0;
+        for (int u = 0; u < g->n; u++)
+            if (ls->independent_set[u])
+                bits[u >> 3] |= 1 << (u & 7);
+    }
+}
+
+static int chils_checkpoint_write(chils *c, const char *path)
+{
+    chils_checkpoint_header *h = &c->checkpoint_header;
+    size_t row = ((size_t)h->n + 7) / 8;
+
+    char *tmp = malloc(strlen(path) + 5);
+    sprintf(tmp, "%s.tmp", path);
+
+    FILE *f = fopen(tmp, "wb");
+    if (f == NULL)
+    {
+        fprintf(stderr, "Unable to open file %s\n", tmp);
+        free(tmp);
+        return 0;
+    }
+
+    int ok = fwrite(CHECKPOINT_MAGIC, 1, 8, f) == 8 &&
+             fwrite(h, sizeof(chils_checkpoint_header), 1, f) == 1 &&
+             fwrite(c->checkpoint_entries, sizeof(chils_checkpoint_entry), h->p, f) == (size_t)h->p &&
+             fwrite(c->checkpoint_bits, row, h->p, f) == (size_t)h->p;
+    ok = fclose(f) == 0 && ok;
+
+    // Replace the previous checkpoint only once the new one is complete
+#ifdef _WIN32
+    if (ok)
+        remove(path);
+#endif
+    ok = ok && rename(tmp, path) == 0;
+
+    if (!ok)
+        fprintf(stderr, "Unable to write checkpoint %s\n", path);
+
+    free(tmp);
+    return ok;
+}
+
+int chils_checkpoint_store(graph *g, chils *c, const char *path)
+{
+#pragma omp parallel
+    chils_checkpoint_snapshot(g, c);
+
+    return chils_checkpoint_write(c, path);
+}
+
+int chils_checkpoint_load(graph *g, chils *c, const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        fprintf(stderr, "Unable to open file %s\n", path);
+        return 0;
+    }
+
+    char magic[8];
+    chils_checkpoint_header h;
+    if (fread(magic, 1, 8, f) != 8 || memcmp(magic, CHECKPOINT_MAGIC, 8) != 0 ||
+        fread(&h, sizeof(chils_checkpoint_header), 1, f) != 1 || h.p < 1)
+    {
+        fprintf(stderr, "%s is not a CHILS checkpoint\n", path);
+        fclose(f);
+        return 0;
+    }
+    if (h.n != g->n || h.m != g->m)
+    {
+        fprintf(stderr, "Checkpoint %s is for a graph with %d vertices and %lld edges\n",
+                path, h.n, h.m / 2);
+        fclose(f);
+        return 0;
+    }
+
+    size_t row = chils_checkpoint_row(g);
+    chils_checkpoint_entry *entries = malloc(sizeof(chils_checkpoint_entry) * h.p);
+    unsigned char *bits = malloc(row * h.p);
+
+    int ok = fread(entries, sizeof(chils_checkpoint_entry), h.p, f) == (size_t)h.p &&
+             fread(bits, row, h.p, f) == (size_t)h.p;
+    fclose(f);
+
+    if (!ok)
+    {
+        fprintf(stderr, "Checkpoint %s is truncated\n", path);
+        free(entries);
+        free(bits);
+        return 0;
+    }
+
+    chils_resize(g, c, h.p);
+
+    double now = omp_get_wtime();
+    int valid = 1;
+
 #pragma omp parallel
     {
+        for (int i = 0; i < h.p; i++)
+        {
+            local_search *ls = c->LS[i];
+            const unsigned char *bi = bits + row * i;
+
+#pragma omp for
+            for (int u = 0; u < g->n; u++)
+                ls->independent_set[u] = (bi[u >> 3] >> (u & 7)) & 1;
+
+            local_search_rebuild_par(g, ls);
+
+#pragma omp for reduction(&& : valid)
+            for (int u = 0; u < g->n; u++)
+                valid = valid && !(ls->independent_set[u] && local_search_tightness(ls, u) > 0);
+
+#pragma omp single
+            {
+                valid = valid && ls->cost == entries[i].cost;
+                ls->seed = entries[i].seed;
+                ls->max_queue = entries[i].max_queue;
+                ls->time = entries[i].time;
+                ls->time_ref = now - entries[i].age;
+                c->full_time[i] = entries[i].full_time;
+                c->core_time[i] = entries[i].core_time;
+            }
+        }
+    }
+
+    free(entries);
+    free(bits);
+
+    if (!valid)
+    {
+        fprintf(stderr, "Checkpoint %s contains invalid solutions\n", path);
+        return 0;
+    }
+
+    c->seed = h.seed;
+    c->it = h.it;
+    c->checkpoint_last = now;
+    chils_update_best(c);
+
+    return 1;
+}
+
+static inline void chils_net_lost(chils *c)
+{
+    fprintf(stderr, "Lost connection to the other CHILS processes, continuing alone\n");
+    c->net = NULL;
+}
+
+// No improvement for stall_iterations iterations or stall_time seconds,
+// should be called with the best solution updated, ci is the current iteration
+static inline int chils_stalled(chils *c, long long ci)
+{
+    if (c->depth > 0)
+        return 0;
+
+    if (c->cost > c->stall_cost)
+    {
+        c->stall_cost = c->cost;
+        c->stall_it = ci;
+        c->stall_start = omp_get_wtime();
+    }
+    return ci - c->stall_it >= c->stall_iterations || omp_get_wtime() - c->stall_start >= c->stall_time;
+}
+
+// Combine the stopping decision of all processes, should be called by one thread
+static inline int chils_stop(chils *c, int stop)
+{
+    if (c->cost >= chils_target(c))
+    {
+        if (c->target_time < 0.0)
+            c->target_time = c->time;
+        stop = 1;
+    }
+    if (c->control != NULL)
+    {
+        int cancel;
+#pragma omp atomic read
+        cancel = c->control->stop;
+        stop = stop || cancel;
+    }
+    if (c->net != NULL && !chils_net_sum(c->net, &stop, 1))
+        chils_net_lost(c);
+    return stop > 0;
+}
+
+/*
+    Share the best solution between processes. If another process has
+    a better one, it replaces the worst local solution.
+    Should be called inside parallel region.
+*/
+static void chils_net_share_best(graph *g, chils *c)
+{
+    size_t row = chils_checkpoint_row(g);
+    int replace = -1;
+
+#pragma omp single copyprivate(replace)
+    {
+        if (c->net_bits == NULL)
+            c->net_bits = malloc(row);
+
+        int best = chils_find_first_best(c);
+        long long cost = c->LS[best]->cost;
+
+        for (size_t b = 0; b < row; b++)
+            c->net_bits[b] = 0;
+        for (int u = 0; u < g->n; u++)
+            if (c->LS[best]->independent_set[u])
+                c->net_bits[u >> 3] |= 1 << (u & 7);
+
+        if (!chils_net_best(c->net, &cost, c->net_bits, row))
+            chils_net_lost(c);
+        else if (cost > c->LS[best]->cost)
+            replace = chils_find_first_worst(c);
+    }
+
+    if (replace < 0)
+        return;
+
+    local_search *ls = c->LS[replace];
+
 #pragma omp for
+    for (int u = 0; u < g->n; u++)
+        ls->independent_set[u] = (c->net_bits[u >> 3] >> (u & 7)) & 1;
+
+    local_search_rebuild_par(g, ls);
+
+#pragma omp single
+    ls->time = omp_get_wtime() - ls->time_ref;
+}
+
+static inline long long chils_core_apply(graph *g, chils *c, int i, local_search *ls, int best)
+{
+    long long ref = 0;
+    for (int u = 0; u < c->d_core->n; u++)
+        if (c->LS[i]->independent_set[c->RM[u]])
+            ref += c->d_core->W[u];
+
+    if (ref <= ls->cost || (i != best && (i % 2) == 0))
+        for (int u = 0; u < c->d_core->n; u++)
+            if (ls->independent_set[u] && !c->LS[i]->independent_set[c->RM[u]])
+                local_search_add_vertex(g, c->LS[i], c->RM[u]);
+
+    if (ref < ls->cost)
+        c->LS[i]->time = ls->time;
+
+    return ref;
+}
+
+/*
+    Should be called with the D-core of the current iteration. Returns 1 if the
+    core was solved optimally, 0 if the node limit or the deadline was reached first,
+    the solution is then only applied if it improves. Cores with more than EXACT_CORE
+    free vertices are rarely proven in time, so they are left to core LS right away
+*/
+static int chils_core_exact(graph *g, chils *c, int i, double deadline)
+{
+    graph *d = c->d_core;
+    local_search *ls = c->LS[i];
+
+    // Core vertices next to the solution outside the core are left out
+    int *F = malloc(sizeof(int) * d->n), *R = malloc(sizeof(int) * d->n);
+    int n = 0;
+    long long m = 0, ref = 0;
+    for (int u = 0; u < d->n; u++)
+    {
+        int x = c->RM[u], allowed = 1;
+        for (long long j = g->V[x]; j < g->V[x + 1] && allowed; j++)
+            if (!c->A[g->E[j]] && ls->independent_set[g->E[j]])
+                allowed = 0;
+
+        F[u] = allowed ? n : -1;
+        if (allowed)
+            R[n++] = u;
+        if (ls->independent_set[x])
+            ref += d->W[u];
+    }
+
+    if (n > EXACT_CORE)
+    {
+        free(F);
+        free(R);
+        return 0;
+    }
+
+    graph sg = {.n = n, .m = 0};
+    sg.V = malloc(sizeof(long long) * (n + 1));
+    sg.E = malloc(sizeof(int) * (d->V[d->n] > 0 ? d->V[d->n] : 1));
+    sg.W = malloc(sizeof(long long) * (n > 0 ? n : 1));
+    for (int k = 0; k < n; k++)
+    {
+        int u = R[k];
+        sg.V[k] = m;
+        sg.W[k] = d->W[u];
+        for (long long j = d->V[u]; j < d->V[u + 1]; j++)
+            if (F[d->E[j]] >= 0)
+                sg.E[m++] = F[d->E[j]];
+    }
+    sg.V[n] = m;
+    sg.m = m;
+
+    int *J = malloc(sizeof(int) * (n > 0 ? n : 1));
+    int optimal = exact_solve(&sg, J, EXACT_NODE_LIMIT, deadline);
+
+    long long cost = 0;
+    for (int k = 0; k < n; k++)
+        if (J[k])
+            cost += sg.W[k];
+
+    // Same as chils_core_apply, through RM, but only when the solution improves
+    if (cost > ref)
+    {
+        for (int u = 0; u < d->n; u++)
+            if (ls->independent_set[c->RM[u]] && (F[u] < 0 || !J[F[u]]))
+                local_search_remove_vertex(g, ls, c->RM[u]);
+        for (int k = 0; k < n; k++)
+            if (J[k] && !ls->independent_set[c->RM[R[k]]])
+                local_search_add_vertex(g, ls, c->RM[R[k]]);
+        ls->time = omp_get_wtime() - ls->time_ref;
+    }
+
+    free(F);
+    free(R);
+    free(sg.V);
+    free(sg.E);
+    free(sg.W);
+    free(J);
+
+    return optimal;
+}
+
+static void chils_run_level(graph *g, chils *c, double start, double tl, long long cl, int verbose);
+
+// Should be called inside parallel region
+static void chils_core_recursive(graph *g, chils *c, double start, double tl, int best)
+{
+    double duration = 0.0, sub_start = 0.0;
+
+#pragma omp single copyprivate(duration, sub_start)
+    {
+        if (c->sub == NULL)
+        {
+            c->sub = chils_init(g, c->p, c->seed + 2 * c->p);
+            c->sub->depth = c->depth + 1;
+        }
+        chils_reserve_threads(c->sub, omp_get_num_threads());
+        c->sub->max_depth = c->max_depth;
+        c->sub->core_limit = c->core_limit;
+        c->sub->step_count = c->step_count;
+        c->sub->step_work = chils_deterministic(c) ? c->step_work / 2 / RECURSIVE_STEPS : LLONG_MAX;
+        c->sub->work_limit = LLONG_MAX;
+        c->sub->adaptive = c->adaptive;
+        c->sub->control = c->control;
+        c->sub->fast_start = c->fast_start;
+
+        duration = 0.0;
         for (int i = 0; i < c->p; i++)
+            if (chils_core_duration(g, c, i) > duration)
+                duration = chils_core_duration(g, c, i);
+        double remaining_time = tl - (omp_get_wtime() - start);
+        if (remaining_time < duration)
+            duration = remaining_time;
+        c->sub->step_time = chils_deterministic(c) ? duration : duration / RECURSIVE_STEPS;
+
+        sub_start = omp_get_wtime();
+    }
+
+    if (duration <= 0.0)
+        return;
+
+    chils *sub = c->sub;
+
+#pragma omp for schedule(dynamic, 1)
+    for (int i = 0; i < c->p; i++)
+    {
+        local_search_reset(c->d_core, sub->LS[i]);
+        sub->LS[i]->time_ref = c->LS[i]->time_ref;
+        sub->LS[i]->max_queue = c->LS[i]->max_queue;
+    }
+
+    chils_run_level(c->d_core, sub, sub_start, duration, RECURSIVE_STEPS, 0);
+
+#pragma omp for schedule(dynamic, 1)
+    for (int i = 0; i < c->p; i++)
+        chils_core_apply(g, c, i, sub->LS[i], best);
+}
+
+// Full graph LS with c->searches_per_thread members per thread. Each member gets the same
+// time as when run on its own, the block of members takes that many times as long.
+// Should be called inside parallel region
+static void chils_full_interleaved(graph *g, chils *c, double start, double tl)
+{
+    int k = c->searches_per_thread, blocks = (c->p + k - 1) / k;
+
+#pragma omp for schedule(dynamic, 1)
+    for (int b = 0; b < blocks; b++)
+    {
+        int first = b * k, count = c->p - first < k ? c->p - first : k, active = 0;
+        int running[CHILS_MAX_INTERLEAVE];
+        long long before[CHILS_MAX_INTERLEAVE];
+        local_search_run R[CHILS_MAX_INTERLEAVE];
+        double slice_start = omp_get_wtime();
+
+        for (int j = 0; j < count; j++)
         {
-            if (c->LS[i]->cost == 0 && i == 0)
-                local_search_in_order_solution(g, c->LS[i]);
-            else if (c->LS[i]->cost == 0)
-                local_search_add_vertex(g, c->LS[i], my_rand_r(&c->LS[i]->seed) % g->n);
+            local_search *ls = c->LS[first + j];
+            double remaining_time = tl - (omp_get_wtime() - start);
+            double duration = chils_full_duration(c, first + j) * count;
+            if (remaining_time < duration)
+                duration = remaining_time;
+
+            running[j] = duration > 0.0;
+            if (!running[j])
+                continue;
 
-            local_search_greedy(g, c->LS[i]);
+            before[j] = ls->cost;
+            ls->work_limit = c->step_work;
+            ls->stop_weight = chils_target(c);
+            ls->stall_time = c->depth == 0 ? c->stall_time : INFINITY;
+            local_search_explore_begin(g, ls, &R[j], duration, c->step_count, 0);
+            active++;
         }
 
+        // After each step, all members prefetch their next step a stage further
+        for (int j = 0; active > 0; j = (j + 1) % count)
+        {
+            if (!running[j])
+                continue;
+
+            local_search *ls = c->LS[first + j];
+            if (local_search_explore_step(g, ls, &R[j]))
+            {
+                for (int l = 0; l < count; l++)
+                    if (running[l])
+                        local_search_prefetch_step(g, c->LS[first + l], &R[l]);
+                continue;
+            }
+
+            local_search_explore_end(ls, &R[j]);
+            running[j] = 0;
+            active--;
+            if (c->adaptive && !chils_deterministic(c))
+                c->full_time[first + j] = chils_adapt(c, c->full_time[first + j], slice_start, ls, before[j]);
+        }
+    }
+}
+
+// Should be called inside parallel region
+static void chils_run_level(graph *g, chils *c, double start, double tl, long long cl, int verbose)
+{
+    double elapsed = 0.0;
+    long long work_start = 0;
+
+#pragma omp single copyprivate(work_start)
+    work_start = chils_work(c);
+
+#pragma omp for
+    for (int i = 0; i < c->p; i++)
+    {
+        // Only solutions on the input graph are reported
+        c->LS[i]->control = c->control;
+        c->LS[i]->report = c->depth == 0;
+        c->LS[i]->deadline = start + tl;
+        if (c->LS[i]->cliques != c->cliques)
+            local_search_set_cliques(g, c->LS[i], c->cliques);
+        if (c->LS[i]->hubs != c->hubs)
+            local_search_set_hubs(g, c->LS[i], c->hubs);
+        c->LS[i]->neighbors = c->neighbors;
+    }
+
+    /* Fast start, one solution from all threads is reported and handed to the rest of the pool */
+    if (c->fast_start)
+    {
+        if (c->LS[0]->cost == 0)
+        {
+            local_search_priority_par(g, c->LS[0], c->S1);
 #pragma omp single
+            {
+                c->LS[0]->time = omp_get_wtime() - c->LS[0]->time_ref;
+                chils_update_best(c);
+            }
+        }
+
+#pragma omp for schedule(dynamic, 1)
+        for (int i = 1; i < c->p; i++)
         {
-            end = omp_get_wtime();
-            elapsed = end - start;
-            chils_update_best(c);
-            if (verbose)
-                chils_print(c, 0, elapsed);
+            local_search *ls = c->LS[i];
+            if (ls->cost > 0 || local_search_stopped(ls))
+                continue;
+
+            local_search_copy(ls, c->LS[0], g->n);
+
+            // Up to START_PERTURBE percent of the vertices are forced in, more for later members
+            long long k = (long long)g->n * i * START_PERTURBE / (100ll * c->p);
+            for (long long j = 0; j < k; j++)
+            {
+                int u = my_rand_r(&ls->seed) % g->n;
+                if (!ls->independent_set[u])
+                    local_search_add_vertex(g, ls, u);
+            }
         }
+    }
+
+#pragma omp for schedule(dynamic, 1)
+    for (int i = 0; i < c->p; i++)
+    {
+        // With a fast start, the rest of the pool is built by later calls if time runs out
+        if (c->fast_start && local_search_stopped(c->LS[i]))
+            continue;
+
+        if (c->LS[i]->cost == 0)
+            local_search_queue_all(g, c->LS[i]);
+
+        if (c->LS[i]->cost == 0 && i == 0)
+            local_search_in_order_solution(g, c->LS[i]);
+        else if (c->LS[i]->cost == 0)
+            local_search_add_vertex(g, c->LS[i], my_rand_r(&c->LS[i]->seed) % g->n);
+
+        local_search_greedy(g, c->LS[i]);
+
+        // Members come online one by one
+        local_search_report(c->LS[i]);
+    }
+
+    int stop = 0;
+#pragma omp single copyprivate(elapsed, stop)
+    {
+        elapsed = omp_get_wtime() - start;
+        chils_update_best(c);
+        c->target_time = -1.0;
+        c->stall_cost = c->cost;
+        c->stall_it = 0;
+        c->stall_start = omp_get_wtime();
+        stop = chils_stop(c, cl < 1 || elapsed >= tl || c->work_limit < 1);
+        if (verbose)
+            chils_print(c, 0, elapsed);
+    }
+
+    long long ci = 0;
+    while (!stop)
+    {
+        ci++;
 
-        long long ci = 0;
-        while (ci++ < cl && elapsed < tl)
+        /* Full graph LS */
+        if (c->searches_per_thread > 1)
+            chils_full_interleaved(g, c, start, tl);
+        else
         {
-            /* Full graph LS */
-#pragma omp for
+#pragma omp for schedule(dynamic, 1)
             for (int i = 0; i < c->p; i++)
             {
                 double remaining_time = tl - (omp_get_wtime() - start);
-                double duration = c->step_time;
+                double duration = chils_full_duration(c, i);
                 if (remaining_time < duration)
                     duration = remaining_time;
                 if (duration > 0.0)
+                {
+                    long long before = c->LS[i]->cost;
+                    double slice_start = omp_get_wtime();
+                    c->LS[i]->work_limit = c->step_work;
+                    c->LS[i]->stop_weight = chils_target(c);
+                    c->LS[i]->stall_time = c->depth == 0 ? c->stall_time : INFINITY;
                     local_search_explore(g, c->LS[i], duration, c->step_count, 0);
+                    if (c->adaptive && !chils_deterministic(c))
+                        c->full_time[i] = chils_adapt(c, c->full_time[i], slice_start, c->LS[i], before);
+                }
             }
+        }
+
+        /* Skip the D-core when it can not be built before the deadline, or the gap is closed */
+        int best = 0, skip = 0;
+#pragma omp single copyprivate(skip)
+        {
+            chils_update_best(c);
+            skip = c->net == NULL && (omp_get_wtime() - start + c->core_build_time >= tl ||
+                                      c->cost >= chils_target(c));
+        }
+
+        if (!skip)
+        {
+            /* Mark the D-core, counting the solutions of all processes */
+            if (c->net != NULL)
+                chils_net_share_best(g, c);
 
-            /* Mark the D-core */
 #pragma omp for nowait
             for (int i = 0; i < g->n; i++)
             {
                 int t = 0;
                 for (int j = 0; j < c->p; j++)
                     t += c->LS[j]->independent_set[i];
-                c->A[i] = t > 0 && t < c->p;
+                c->A[i] = c->net != NULL ? t : (t > 0 && t < c->p);
+            }
+
+            if (c->net != NULL)
+            {
+                int p = c->p;
+#pragma omp barrier
+#pragma omp single copyprivate(p)
+                {
+                    if (!chils_net_sum(c->net, c->A, g->n) || !chils_net_sum(c->net, &p, 1))
+                    {
+                        chils_net_lost(c);
+                        p = INT_MAX;
+                    }
+                }
+#pragma omp for nowait
+                for (int i = 0; i < g->n; i++)
+                    c->A[i] = c->A[i] > 0 && c->A[i] < p;
             }
 
             /* Find the best solution */
-            int best = chils_find_first_best(c);
+            best = chils_find_first_best(c);
 
             /* Construct the D-core */
-#pragma omp single
+#pragma omp single copyprivate(elapsed)
             {
-                end = omp_get_wtime();
-                elapsed = end - start;
+                c->core_build_time = omp_get_wtime();
+                elapsed = c->core_build_time - start;
                 chils_update_best(c);
                 if (verbose)
                     chils_print(c, ci, elapsed);
@@ -225,79 +1183,175 @@ void chils_run(graph *g, chils *c, double tl, long long cl, int verbose)
 
             graph_subgraph_par(g, c->d_core, c->A, c->RM, c->FM, c->S1, c->S2);
 
-#pragma omp single
+#pragma omp single copyprivate(elapsed)
             {
-                end = omp_get_wtime();
-                elapsed = end - start;
+                c->core_build_time = omp_get_wtime() - c->core_build_time;
+                elapsed = omp_get_wtime() - start;
                 if (verbose)
                     chils_print(c, ci, elapsed);
             }
 
-            /* D-core LS */
-#pragma omp for
-            for (int i = 0; i < c->p; i++)
+            /* D-core LS, or CHILS on the D-core if it is still large */
+            if (c->depth < c->max_depth && c->d_core->n > c->core_limit)
             {
-                if (c->d_core->n == 0)
-                    continue;
+                chils_core_recursive(g, c, start, tl, best);
+            }
+            else
+            {
+#pragma omp for schedule(dynamic, 1)
+                for (int i = 0; i < c->p; i++)
+                {
+                    if (c->d_core->n == 0)
+                        continue;
 
-                double remaining_time = tl - (omp_get_wtime() - start);
-                double duration = c->step_time * 0.5;
-                if (remaining_time < duration)
-                    duration = remaining_time;
+                    double remaining_time = tl - (omp_get_wtime() - start);
+                    double duration = chils_core_duration(g, c, i);
+                    if (remaining_time < duration)
+                        duration = remaining_time;
 
-                if (duration < 0.0)
-                    continue;
+                    if (duration < 0.0)
+                        continue;
 
-                local_search_reset(c->d_core, c->LS_core[i]);
-                c->LS_core[i]->time_ref = c->LS[i]->time_ref;
+                    // Small cores are solved exactly with the rest of the solution fixed, core LS
+                    // gets what is left of the slice when that fails
+                    if (c->d_core->n < MIN_CORE)
+                    {
+                        double exact_start = omp_get_wtime();
+                        if (chils_core_exact(g, c, i, exact_start + duration))
+                            continue;
+                        duration -= omp_get_wtime() - exact_start;
+                        if (duration <= 0.0)
+                            continue;
+                    }
 
-                long long ref = 0;
-                for (int u = 0; u < c->d_core->n; u++)
-                    if (c->LS[i]->independent_set[c->RM[u]])
-                        ref += c->d_core->W[u];
+                    if (c->LS_core[i] == NULL)
+                    {
+                        c->LS_core[i] = local_search_init(g, c->seed + c->p + i);
+                        c->LS_core[i]->max_queue = c->LS[i]->max_queue;
+                        c->LS_core[i]->report = 0;
+                    }
 
-                local_search_explore(c->d_core, c->LS_core[i], duration, c->step_count, 0);
+                    local_search_reset(c->d_core, c->LS_core[i]);
+                    c->LS_core[i]->time_ref = c->LS[i]->time_ref;
+                    c->LS_core[i]->control = c->control;
+                    c->LS_core[i]->deadline = start + tl;
 
-                if (ref <= c->LS_core[i]->cost || (i != best && (i % 2) == 0))
-                    for (int u = 0; u < c->d_core->n; u++)
-                        if (c->LS_core[i]->independent_set[u] && !c->LS[i]->independent_set[c->RM[u]])
-                            local_search_add_vertex(g, c->LS[i], c->RM[u]);
+                    double slice_start = omp_get_wtime();
+                    c->LS_core[i]->work_limit = chils_deterministic(c) ? c->step_work / 2 : LLONG_MAX;
+                    local_search_explore(c->d_core, c->LS_core[i], duration, c->step_count, 0);
 
-                if (ref < c->LS_core[i]->cost)
-                    c->LS[i]->time = c->LS_core[i]->time;
+                    long long ref = chils_core_apply(g, c, i, c->LS_core[i], best);
+                    if (c->adaptive && !chils_deterministic(c))
+                        c->core_time[i] = chils_adapt(c, c->core_time[i], slice_start, c->LS_core[i], ref);
+                }
             }
+        }
 
-            /* Find the best solution after LS on the CHILS core */
-            best = chils_find_first_best(c);
+        /* Find the best solution after LS on the CHILS core */
+        best = chils_find_first_best(c);
 
 #pragma omp barrier
+#pragma omp for schedule(dynamic, 1)
+        for (int i = 0; i < c->p; i++)
+        {
+            if (c->d_core->n < MIN_CORE && i != best && (i % 2) == 0)
+                local_search_perturbe(g, c->LS[i]);
+        }
+
+        int checkpoint = 0;
+#pragma omp single copyprivate(elapsed, checkpoint, stop)
+        {
+            elapsed = omp_get_wtime() - start;
+            chils_update_best(c);
+            stop = chils_stop(c, ci >= cl || elapsed >= tl || chils_work(c) - work_start >= c->work_limit ||
+                                     chils_stalled(c, ci));
+            c->it++;
+            checkpoint = c->checkpoint_path != NULL &&
+                         omp_get_wtime() - c->checkpoint_last >= c->checkpoint_interval;
+            if (verbose)
+                chils_print(c, ci, elapsed);
+        }
+
+        /* Snapshot together, then one thread writes while the rest continue */
+        if (checkpoint)
+        {
+            chils_checkpoint_snapshot(g, c);
+#pragma omp single nowait
+            chils_checkpoint_write(c, c->checkpoint_path);
+        }
+    }
+
 #pragma omp for
-            for (int i = 0; i < c->p; i++)
-            {
-                if (c->d_core->n < MIN_CORE && i != best && (i % 2) == 0)
-                    local_search_perturbe(g, c->LS[i]);
-            }
+    for (int i = 0; i < c->p; i++)
+    {
+        c->LS[i]->deadline = INFINITY;
+        if (c->LS_core[i] != NULL)
+            c->LS_core[i]->deadline = INFINITY;
+    }
 
+    /* Leave every process with the overall best solution */
+    if (c->net != NULL)
+    {
+        chils_net_share_best(g, c);
 #pragma omp single
-            {
-                end = omp_get_wtime();
-                elapsed = end - start;
-                chils_update_best(c);
-                if (verbose)
-                    chils_print(c, ci, elapsed);
-            }
+        chils_update_best(c);
+    }
+}
+
+long long chils_work(chils *c)
+{
+    if (c == NULL)
+        return 0;
+
+    long long work = chils_work(c->sub);
+    for (int i = 0; i < c->p; i++)
+        work += c->LS[i]->work + (c->LS_core[i] != NULL ? c->LS_core[i]->work : 0);
+    return work;
+}
+
+void chils_run_team(graph *g, chils *c, double tl, long long cl, int verbose)
+{
+    double start = 0.0;
+
+#pragma omp single copyprivate(start)
+    {
+        start = omp_get_wtime();
+        chils_reserve_threads(c, omp_get_num_threads());
+        chils_cover_start(g, c);
+
+        if (verbose)
+        {
+            if (cl < LLONG_MAX)
+                printf("Running chils for %.2lf seconds or %lld iterations\n", tl, cl);
+            else
+                printf("Running chils for %.2lf seconds\n", tl);
+            printf("%7s %12s (%3s %8s) %12s (%3s %8s) %8s %9s %12s %8s\n", "It.",
+                   "Best WIS", "id", "time",
+                   "Worst WIS", "id", "time",
+                   "time", "D-Core V", "D-Core E", "Gap");
+            chils_print(c, 0, 0.0);
         }
     }
 
+    chils_run_level(g, c, start, tl, cl, verbose);
+
     if (verbose)
+    {
+#pragma omp single
         printf("\n");
+    }
+}
+
+void chils_run(graph *g, chils *c, double tl, long long cl, int verbose)
+{
+#pragma omp parallel
+    chils_run_team(g, c, tl, cl, verbose);
 }
 
 void chils_set_solution(graph *g, chils *c, int i, const int *I)
 {
-    for (int j = 0; j < g->n; j++)
-        if (I[j])
-            local_search_add_vertex(g, c->LS[i], j);
+#pragma omp parallel
+    local_search_set_solution_par(g, c->LS[i], I);
 }
 
 int *chils_get_best_independent_set(chils *c)
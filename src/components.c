@@ -0,0 +1,337 @@
+#include "components.h"
+#include "chils_internal.h"
+#include "exact.h"
+
+#include <omp.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#define COMPONENT_EXACT 64
+#define COMPONENT_LARGE (1 << 12)
+#define EXACT_NODE_LIMIT (1 << 16)
+
+components *components_init(graph *g)
+{
+    components *cc = malloc(sizeof(components));
+
+    cc->C = malloc(sizeof(int) * g->n);
+    cc->k = graph_components_par(g, cc->C);
+
+    cc->N = calloc(cc->k, sizeof(int));
+    cc->M = calloc(cc->k, sizeof(long long));
+    cc->X = malloc(sizeof(long long) * (cc->k + 1));
+    cc->L = malloc(sizeof(int) * g->n);
+
+    for (int u = 0; u < g->n; u++)
+    {
+        cc->N[cc->C[u]]++;
+        cc->M[cc->C[u]] += g->V[u + 1] - g->V[u];
+    }
+
+    cc->X[0] = 0;
+    for (int c = 0; c < cc->k; c++)
+        cc->X[c + 1] = cc->X[c] + cc->N[c];
+
+    // Vertices stay sorted within each component
+    long long *P = malloc(sizeof(long long) * (cc->k + 1));
+    for (int c = 0; c <= cc->k; c++)
+        P[c] = cc->X[c];
+    for (int u = 0; u < g->n; u++)
+        cc->L[P[cc->C[u]]++] = u;
+    free(P);
+
+    return cc;
+}
+
+void components_free(components *cc)
+{
+    if (cc == NULL)
+        return;
+
+    free(cc->C);
+    free(cc->N);
+    free(cc->M);
+    free(cc->X);
+    free(cc->L);
+
+    free(cc);
+}
+
+static inline int components_find(const int *L, int n, int u)
+{
+    int l = 0, r = n - 1;
+    while (l < r)
+    {
+        int m = (l + r) / 2;
+        if (L[m] < u)
+            l = m + 1;
+        else
+            r = m;
+    }
+    return l;
+}
+
+// Heaviest first greedy solution for the n vertices in L, which form a whole component
+static void components_greedy(graph *g, const int *L, int n, int *I)
+{
+    long long W[COMPONENT_EXACT];
+    int order[COMPONENT_EXACT];
+    for (int i = 0; i < n; i++)
+    {
+        long long w = g->W[L[i]];
+        int j = i;
+        while (j > 0 && W[j - 1] < w)
+        {
+            W[j] = W[j - 1];
+            order[j] = order[j - 1];
+            j--;
+        }
+        W[j] = w;
+        order[j] = L[i];
+    }
+
+    for (int i = 0; i < n && W[i] > 0; i++)
+    {
+        int u = order[i];
+
+        int take = 1;
+        for (long long j = g->V[u]; j < g->V[u + 1] && take; j++)
+            take = !I[g->E[j]];
+        I[u] = take;
+    }
+}
+
+// Exact solutions for all components with at most COMPONENT_EXACT vertices, returns the number proven optimal.
+// Components still left at the deadline get a greedy solution instead
+static int components_solve_exact(graph *g, components *cc, int *I, double deadline)
+{
+    int optimal = 0;
+
+#pragma omp parallel reduction(+ : optimal)
+    {
+        long long V[COMPONENT_EXACT + 1], W[COMPONENT_EXACT];
+        int E[COMPONENT_EXACT * (COMPONENT_EXACT - 1)], J[COMPONENT_EXACT];
+        graph sg = {.V = V, .E = E, .W = W};
+        int late = 0;
+
+#pragma omp for schedule(dynamic, 64)
+        for (int c = 0; c < cc->k; c++)
+        {
+            if (cc->N[c] > COMPONENT_EXACT)
+                continue;
+
+            const int *L = cc->L + cc->X[c];
+            int n = cc->N[c];
+
+            if (n == 1)
+            {
+                I[L[0]] = g->W[L[0]] > 0;
+                optimal++;
+                continue;
+            }
+
+            if (!late)
+                late = omp_get_wtime() >= deadline;
+            if (late)
+            {
+                components_greedy(g, L, n, I);
+                continue;
+            }
+
+            long long m = 0;
+            for (int i = 0; i < n; i++)
+            {
+                int u = L[i];
+                V[i] = m;
+                W[i] = g->W[u];
+                for (long long j = g->V[u]; j < g->V[u + 1]; j++)
+                    E[m++] = components_find(L, n, g->E[j]);
+            }
+            V[n] = m;
+            sg.n = n;
+            sg.m = m;
+
+            optimal += exact_solve(&sg, J, EXACT_NODE_LIMIT, deadline);
+
+            for (int i = 0; i < n; i++)
+                I[L[i]] = J[i];
+        }
+    }
+
+    return optimal;
+}
+
+// Subgraph of the k whole components in S, FM maps g to the subgraph and RM back
+static graph *components_subgraph(graph *g, components *cc, const int *S, int k, int *FM, int *RM)
+{
+    long long n = 0, m = 0;
+    for (int i = 0; i < k; i++)
+    {
+        int c = S[i];
+        for (long long j = cc->X[c]; j < cc->X[c + 1]; j++)
+        {
+            int u = cc->L[j];
+            FM[u] = n;
+            RM[n++] = u;
+        }
+        m += cc->M[c];
+    }
+
+    graph *sg = malloc(sizeof(graph));
+    *sg = (graph){.n = n, .m = m};
+
+    sg->V = malloc(sizeof(long long) * (n + 1));
+    sg->E = malloc(sizeof(int) * (m + 1));
+    sg->W = malloc(sizeof(long long) * (n + 1));
+
+    m = 0;
+    for (int u = 0; u < n; u++)
+    {
+        int v = RM[u];
+        sg->W[u] = g->W[v];
+        sg->V[u] = m;
+        for (long long i = g->V[v]; i < g->V[v + 1]; i++)
+            sg->E[m++] = FM[g->E[i]];
+    }
+    sg->V[n] = m;
+
+    return sg;
+}
+
+long long components_solve(graph *g, components *cc, components_settings s, double tl, long long cl,
+                           int *I, double *time, int verbose)
+{
+    double start = omp_get_wtime();
+
+    for (int u = 0; u < g->n; u++)
+        I[u] = 0;
+
+    // Group 0 holds the components between COMPONENT_EXACT and COMPONENT_LARGE vertices
+    int groups = 1, small = 0;
+    int *G = malloc(sizeof(int) * cc->k);
+    for (int c = 0; c < cc->k; c++)
+    {
+        if (cc->N[c] <= COMPONENT_EXACT)
+        {
+            G[c] = -1;
+            small++;
+        }
+        else if (cc->N[c] < COMPONENT_LARGE)
+            G[c] = 0;
+        else
+            G[c] = groups++;
+    }
+
+    long long *size = calloc(groups, sizeof(long long)), left = 0, exact_size = 0;
+    for (int c = 0; c < cc->k; c++)
+    {
+        if (G[c] < 0)
+        {
+            exact_size += cc->N[c] + cc->M[c];
+            continue;
+        }
+        size[G[c]] += cc->N[c] + cc->M[c];
+        left += cc->N[c] + cc->M[c];
+    }
+
+    // The exact phase gets its share of tl like any group, the rest is left for the searches
+    double exact_share = left > 0 ? tl * (double)exact_size / (double)(exact_size + left) : tl;
+    int optimal = components_solve_exact(g, cc, I, start + exact_share);
+    *time = omp_get_wtime() - start;
+
+    if (verbose)
+        printf("Components: \t\t%d, %d of %d small ones solved optimally in %.2lf seconds\n",
+               cc->k, optimal, small, *time);
+
+    // Components of each group, in S[X[gi]..X[gi + 1])
+    int *X = calloc(groups + 1, sizeof(int)), *S = malloc(sizeof(int) * (cc->k + 1));
+    for (int c = 0; c < cc->k; c++)
+        if (G[c] >= 0)
+            X[G[c] + 1]++;
+    for (int gi = 0; gi < groups; gi++)
+        X[gi + 1] += X[gi];
+    for (int c = 0; c < cc->k; c++)
+        if (G[c] >= 0)
+            S[X[G[c]]++] = c;
+    for (int gi = groups; gi > 0; gi--)
+        X[gi] = X[gi - 1];
+    X[0] = 0;
+
+    int *FM = malloc(sizeof(int) * g->n);
+    int *RM = malloc(sizeof(int) * g->n);
+
+    // Large components first, then the rest together
+    for (int i = 1; i <= groups; i++)
+    {
+        int gi = i % groups;
+        if (size[gi] == 0)
+            continue;
+
+        double group_start = omp_get_wtime();
+        double share = (tl - (group_start - start)) * (double)size[gi] / (double)left;
+        left -= size[gi];
+
+        graph *sg = components_subgraph(g, cc, S + X[gi], X[gi + 1] - X[gi], FM, RM);
+
+        if (verbose)
+            printf("\nComponent group %d: \t%d vertices, %.2lf seconds\n", gi, sg->n, share);
+
+        const int *S;
+        double found;
+        chils *c = NULL;
+        local_search *ls = NULL;
+
+        if (s.p > 1)
+        {
+            c = chils_init(sg, s.p, s.seed + gi);
+            c->step_time = tl > 0.0 ? s.step_time * share / tl : s.step_time;
+            c->step_count = s.step_count;
+            c->max_depth = s.max_depth;
+            c->core_limit = s.core_limit;
+            c->adaptive = s.adaptive;
+            c->fast_start = s.fast_start;
+            for (int j = 0; j < s.p; j++)
+                c->LS[j]->max_queue = s.max_queue + (4 * j);
+
+            chils_run(sg, c, share > 0.0 ? share : 0.0, cl, verbose);
+
+            S = chils_get_best_independent_set(c);
+            found = c->time;
+        }
+        else
+        {
+            ls = local_search_init(sg, s.seed + gi);
+            ls->max_queue = s.max_queue;
+
+            local_search_explore(sg, ls, share > 0.0 ? share : 0.0, cl, verbose);
+
+            S = ls->independent_set;
+            found = ls->time;
+        }
+
+        for (int u = 0; u < sg->n; u++)
+            I[RM[u]] = S[u];
+
+        if (group_start - start + found > *time)
+            *time = group_start - start + found;
+
+        chils_free(c);
+        local_search_free(ls);
+        graph_free(sg);
+    }
+
+    long long cost = 0;
+    for (int u = 0; u < g->n; u++)
+        if (I[u])
+            cost += g->W[u];
+
+    free(G);
+    free(size);
+    free(X);
+    free(S);
+    free(FM);
+    free(RM);
+
+    return cost;
+}
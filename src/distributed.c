@@ -0,0 +1,317 @@
+#include "distributed.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
+#define CONNECT_ATTEMPTS 600
+#define CONNECT_DELAY_US 100000
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#ifndef _WIN32
+
+typedef struct
+{
+    int size;
+    int *fd; // Socket for each peer, rank 0 only for the other ranks
+} socket_data;
+
+static int socket_send(chils_transport *t, int peer, const void *buf, size_t len)
+{
+    int fd = ((socket_data *)t->data)->fd[peer];
+    const char *p = buf;
+    while (len > 0)
+    {
+        ssize_t r = send(fd, p, len, MSG_NOSIGNAL);
+        if (r <= 0)
+            return 0;
+        p += r;
+        len -= r;
+    }
+    return 1;
+}
+
+static int socket_recv(chils_transport *t, int peer, void *buf, size_t len)
+{
+    int fd = ((socket_data *)t->data)->fd[peer];
+    char *p = buf;
+    while (len > 0)
+    {
+        ssize_t r = recv(fd, p, len, 0);
+        if (r <= 0)
+            return 0;
+        p += r;
+        len -= r;
+    }
+    return 1;
+}
+
+static void socket_close(chils_transport *t)
+{
+    socket_data *sd = t->data;
+    for (int i = 0; i < sd->size; i++)
+        if (sd->fd[i] >= 0)
+            close(sd->fd[i]);
+
+    free(sd->fd);
+    free(sd);
+    free(t);
+}
+
+static void socket_options(int fd, int tcp)
+{
+    int one = 1;
+#ifdef SO_NOSIGPIPE
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    if (tcp)
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+/*
+    Create a socket for address, either bound and listening (rank 0)
+    or connected. Returns the file descriptor, or -1 on failure.
+*/
+static int socket_open(const char *address, int listening)
+{
+    if (strncmp(address, "unix:", 5) == 0)
+    {
+        struct sockaddr_un sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+        if (strlen(address + 5) >= sizeof(sa.sun_path))
+            return -1;
+        strcpy(sa.sun_path, address + 5);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+        socket_options(fd, 0);
+
+        if (listening)
+        {
+            unlink(sa.sun_path);
+            if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) == 0 && listen(fd, SOMAXCONN) == 0)
+                return fd;
+        }
+        else if (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) == 0)
+        {
+            return fd;
+        }
+        close(fd);
+        return -1;
+    }
+
+    if (strncmp(address, "tcp:", 4) != 0)
+        return -1;
+
+    char host[256];
+    const char *port = strrchr(address + 4, ':');
+    if (port == NULL || (size_t)(port - (address + 4)) >= sizeof(host))
+        return -1;
+    memcpy(host, address + 4, port - (address + 4));
+    host[port - (address + 4)] = '\0';
+    port++;
+
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listening ? AI_PASSIVE : 0;
+
+    if (getaddrinfo(host[0] == '\0' || strcmp(host, "*") == 0 ? NULL : host, port, &hints, &res) != 0)
+        return -1;
+
+    int fd = -1;
+    for (struct addrinfo *a = res; a != NULL && fd < 0; a = a->ai_next)
+    {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd < 0)
+            continue;
+        socket_options(fd, 1);
+
+        int one = 1;
+        if (listening)
+        {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (bind(fd, a->ai_addr, a->ai_addrlen) == 0 && listen(fd, SOMAXCONN) == 0)
+                continue;
+        }
+        else if (connect(fd, a->ai_addr, a->ai_addrlen) == 0)
+        {
+            continue;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+
+    return fd;
+}
+
+static chils_transport *socket_transport(const char *address, int rank, int size)
+{
+    int *fds = malloc(sizeof(int) * size);
+    for (int i = 0; i < size; i++)
+        fds[i] = -1;
+
+    int ok = 1;
+    if (rank == 0)
+    {
+        int lfd = socket_open(address, 1);
+        ok = lfd >= 0;
+        for (int i = 1; i < size && ok; i++)
+        {
+            int fd = accept(lfd, NULL, NULL), r = -1;
+            ok = fd >= 0 && recv(fd, &r, sizeof(int), MSG_WAITALL) == sizeof(int) &&
+                 r > 0 && r < size && fds[r] < 0;
+            if (ok)
+                fds[r] = fd;
+        }
+        if (lfd >= 0)
+            close(lfd);
+        if (strncmp(address, "unix:", 5) == 0)
+            unlink(address + 5);
+    }
+    else
+    {
+        // Rank 0 may not be listening yet
+        int fd = -1;
+        for (int i = 0; i < CONNECT_ATTEMPTS && fd < 0; i++)
+        {
+            fd = socket_open(address, 0);
+            if (fd < 0)
+                usleep(CONNECT_DELAY_US);
+        }
+        ok = fd >= 0 && send(fd, &rank, sizeof(int), MSG_NOSIGNAL) == sizeof(int);
+        fds[0] = fd;
+    }
+
+    if (!ok)
+    {
+        fprintf(stderr, "Unable to connect rank %d of %d using %s\n", rank, size, address);
+        for (int i = 0; i < size; i++)
+            if (fds[i] >= 0)
+                close(fds[i]);
+        free(fds);
+        return NULL;
+    }
+
+    socket_data *sd = malloc(sizeof(socket_data));
+    *sd = (socket_data){.size = size, .fd = fds};
+
+    chils_transport *t = malloc(sizeof(chils_transport));
+    *t = (chils_transport){.send = socket_send, .recv = socket_recv, .close = socket_close, .data = sd};
+    return t;
+}
+
+#else
+
+static chils_transport *socket_transport(const char *address, int rank, int size)
+{
+    fprintf(stderr, "Distributed mode is not supported on this platform\n");
+    return NULL;
+}
+
+#endif
+
+chils_net *chils_net_init(const char *address, int rank, int size)
+{
+    if (size < 1 || rank < 0 || rank >= size)
+    {
+        fprintf(stderr, "Invalid rank %d for %d processes\n", rank, size);
+        return NULL;
+    }
+
+    chils_transport *t = NULL;
+    if (size > 1)
+    {
+        t = socket_transport(address, rank, size);
+        if (t == NULL)
+            return NULL;
+    }
+
+    chils_net *net = malloc(sizeof(chils_net));
+    *net = (chils_net){.rank = rank, .size = size, .t = t};
+
+    return net;
+}
+
+void chils_net_free(chils_net *net)
+{
+    if (net == NULL)
+        return;
+
+    if (net->t != NULL)
+        net->t->close(net->t);
+
+    free(net);
+}
+
+int chils_net_sum(chils_net *net, int *data, size_t count)
+{
+    if (net->size == 1)
+        return 1;
+
+    chils_transport *t = net->t;
+    size_t len = sizeof(int) * count;
+
+    if (net->rank > 0)
+        return t->send(t, 0, data, len) && t->recv(t, 0, data, len);
+
+    int *buf = malloc(len), ok = 1;
+    for (int r = 1; r < net->size && ok; r++)
+    {
+        ok = t->recv(t, r, buf, len);
+        for (size_t i = 0; i < count && ok; i++)
+            data[i] += buf[i];
+    }
+    for (int r = 1; r < net->size && ok; r++)
+        ok = t->send(t, r, data, len);
+
+    free(buf);
+    return ok;
+}
+
+int chils_net_best(chils_net *net, long long *cost, unsigned char *bits, size_t len)
+{
+    if (net->size == 1)
+        return 1;
+
+    chils_transport *t = net->t;
+
+    if (net->rank > 0)
+        return t->send(t, 0, cost, sizeof(long long)) && t->send(t, 0, bits, len) &&
+               t->recv(t, 0, cost, sizeof(long long)) && t->recv(t, 0, bits, len);
+
+    unsigned char *buf = malloc(len);
+    int ok = 1;
+    for (int r = 1; r < net->size && ok; r++)
+    {
+        long long c = 0;
+        ok = t->recv(t, r, &c, sizeof(long long)) && t->recv(t, r, buf, len);
+        if (ok && c > *cost)
+        {
+            *cost = c;
+            memcpy(bits, buf, len);
+        }
+    }
+    for (int r = 1; r < net->size && ok; r++)
+        ok = t->send(t, r, cost, sizeof(long long)) && t->send(t, r, bits, len);
+
+    free(buf);
+    return ok;
+}
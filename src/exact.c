@@ -0,0 +1,292 @@
+#include "exact.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <omp.h>
+
+typedef struct
+{
+    long long w;
+    int u;
+} exact_vertex;
+
+typedef struct
+{
+    int n, words;
+    long long nodes, node_limit;
+    double deadline;
+    int stopped;
+
+    uint64_t *A; // Adjacency bitsets, vertices are numbered by decreasing weight
+    uint64_t *P; // Candidate set at each depth
+    uint64_t *Q; // Common neighborhoods of the cliques in the bound
+    uint64_t *T; // Neighborhood in the candidate set, for the reductions
+    long long *W;
+
+    int *S, *B; // Current and best solution
+    int size, best_size;
+    long long cost, best;
+} exact;
+
+static int exact_vertex_compare(const void *a, const void *b)
+{
+    const exact_vertex *x = a, *y = b;
+    if (x->w != y->w)
+        return (x->w < y->w) - (x->w > y->w);
+    return (x->u > y->u) - (x->u < y->u);
+}
+
+static inline int exact_first(uint64_t *X, int words)
+{
+    for (int i = 0; i < words; i++)
+        if (X[i])
+            return i * 64 + __builtin_ctzll(X[i]);
+    return -1;
+}
+
+// Greedy clique cover of P, stops as soon as the bound exceeds limit
+static long long exact_bound(exact *e, uint64_t *P, long long limit)
+{
+    long long bound = 0;
+    int cliques = 0;
+
+    for (int i = 0; i < e->words; i++)
+    {
+        uint64_t X = P[i];
+        while (X)
+        {
+            int v = i * 64 + __builtin_ctzll(X);
+            X &= X - 1;
+
+            int c = 0;
+            while (c < cliques && !((e->Q[c * e->words + i] >> (v & 63)) & 1))
+                c++;
+
+            uint64_t *A = e->A + (long long)v * e->words, *Q = e->Q + (long long)c * e->words;
+            if (c == cliques)
+            {
+                // The first vertex is the heaviest in its clique
+                bound += e->W[v];
+                if (bound > limit)
+                    return bound;
+                for (int j = 0; j < e->words; j++)
+                    Q[j] = A[j];
+                cliques++;
+            }
+            else
+            {
+                for (int j = 0; j < e->words; j++)
+                    Q[j] &= A[j];
+            }
+        }
+    }
+
+    return bound;
+}
+
+static inline void exact_update_best(exact *e)
+{
+    if (e->cost <= e->best)
+        return;
+
+    e->best = e->cost;
+    e->best_size = e->size;
+    for (int i = 0; i < e->size; i++)
+        e->B[i] = e->S[i];
+}
+
+// Take v, which has no neighbors left in P
+static inline void exact_take_isolated(exact *e, uint64_t *P, int v)
+{
+    P[v >> 6] &= ~(1ull << (v & 63));
+    if (e->W[v] > 0)
+    {
+        e->S[e->size++] = v;
+        e->cost += e->W[v];
+    }
+}
+
+/*
+    Vertices without neighbors in P are taken, and u is removed if a neighbor v at
+    least as heavy has N(v) \ {u} within N(u). The second rule only checks v of degree
+    one unless full, which also repeats until nothing changes, as it costs O(m) per pass
+*/
+static void exact_reduce(exact *e, uint64_t *P, int full)
+{
+    uint64_t *T = e->T;
+    int changed = 1;
+    while (changed)
+    {
+        changed = 0;
+        for (int i = 0; i < e->words; i++)
+        {
+            uint64_t X = P[i];
+            while (X)
+            {
+                int v = i * 64 + __builtin_ctzll(X);
+                X &= X - 1;
+                if (!((P[i] >> (v & 63)) & 1))
+                    continue;
+
+                uint64_t *A = e->A + (long long)v * e->words;
+                int degree = 0;
+                for (int j = 0; j < e->words; j++)
+                {
+                    T[j] = A[j] & P[j];
+                    degree += __builtin_popcountll(T[j]);
+                }
+
+                if (degree == 0)
+                {
+                    exact_take_isolated(e, P, v);
+                    continue;
+                }
+
+                if (!full && degree > 1)
+                    continue;
+
+                for (int j = 0; j < e->words; j++)
+                {
+                    uint64_t Y = T[j];
+                    while (Y)
+                    {
+                        int u = j * 64 + __builtin_ctzll(Y);
+                        Y &= Y - 1;
+                        if (e->W[u] > e->W[v])
+                            continue;
+
+                        uint64_t *B = e->A + (long long)u * e->words, extra = 0;
+                        T[j] &= ~(1ull << (u & 63));
+                        for (int k = 0; k < e->words && !extra; k++)
+                            extra = T[k] & ~B[k];
+
+                        if (extra)
+                            T[j] |= 1ull << (u & 63);
+                        else
+                        {
+                            P[j] &= ~(1ull << (u & 63));
+                            degree--;
+                            changed = full;
+                        }
+                    }
+                }
+
+                if (degree == 0)
+                    exact_take_isolated(e, P, v);
+            }
+        }
+    }
+}
+
+static void exact_branch(exact *e, int d)
+{
+    exact_update_best(e);
+
+    if (e->stopped || e->nodes++ >= e->node_limit)
+        return;
+
+    if ((e->nodes & ((1 << 8) - 1)) == 0 && e->deadline < INFINITY && omp_get_wtime() >= e->deadline)
+    {
+        e->stopped = 1;
+        return;
+    }
+
+    // The parent writes P again before its next child, so the reductions can change it in place
+    uint64_t *P = e->P + (long long)d * e->words, *N = P + e->words;
+    int v = exact_first(P, e->words);
+    if (v < 0 || e->cost + exact_bound(e, P, e->best - e->cost) <= e->best)
+        return;
+
+    int size = e->size;
+    long long cost = e->cost;
+    exact_reduce(e, P, d == 0);
+    exact_update_best(e);
+
+    v = exact_first(P, e->words);
+    if (v < 0)
+    {
+        e->size = size;
+        e->cost = cost;
+        return;
+    }
+
+    uint64_t *A = e->A + (long long)v * e->words;
+
+    // Take v first, then leave it out
+    for (int i = 0; i < e->words; i++)
+        N[i] = P[i] & ~A[i];
+    N[v >> 6] &= ~(1ull << (v & 63));
+
+    e->S[e->size++] = v;
+    e->cost += e->W[v];
+    exact_branch(e, d + 1);
+    e->size--;
+    e->cost -= e->W[v];
+
+    for (int i = 0; i < e->words; i++)
+        N[i] = P[i];
+    N[v >> 6] &= ~(1ull << (v & 63));
+
+    exact_branch(e, d + 1);
+
+    e->size = size;
+    e->cost = cost;
+}
+
+int exact_solve(graph *g, int *I, long long node_limit, double deadline)
+{
+    int n = g->n, words = (n + 63) / 64;
+
+    exact_vertex *order = malloc(sizeof(exact_vertex) * n);
+    int *F = malloc(sizeof(int) * n);
+    for (int u = 0; u < n; u++)
+        order[u] = (exact_vertex){.w = g->W[u], .u = u};
+    qsort(order, n, sizeof(exact_vertex), exact_vertex_compare);
+    for (int i = 0; i < n; i++)
+        F[order[i].u] = i;
+
+    exact e = {.n = n, .words = words, .nodes = 0, .node_limit = node_limit, .deadline = deadline,
+               .stopped = 0, .size = 0, .best_size = 0, .cost = 0, .best = 0};
+
+    e.A = calloc((size_t)n * words + 1, sizeof(uint64_t));
+    e.P = calloc((size_t)(n + 2) * words + 1, sizeof(uint64_t));
+    e.Q = malloc(sizeof(uint64_t) * ((size_t)n * words + 1));
+    e.T = malloc(sizeof(uint64_t) * (words + 1));
+    e.W = malloc(sizeof(long long) * (n + 1));
+    e.S = malloc(sizeof(int) * (n + 1));
+    e.B = malloc(sizeof(int) * (n + 1));
+
+    for (int u = 0; u < n; u++)
+    {
+        int x = F[u];
+        e.W[x] = g->W[u];
+        e.P[x >> 6] |= 1ull << (x & 63);
+        for (long long i = g->V[u]; i < g->V[u + 1]; i++)
+        {
+            int y = F[g->E[i]];
+            e.A[(long long)x * words + (y >> 6)] |= 1ull << (y & 63);
+        }
+    }
+
+    exact_branch(&e, 0);
+
+    for (int u = 0; u < n; u++)
+        I[u] = 0;
+    for (int i = 0; i < e.best_size; i++)
+        I[order[e.B[i]].u] = 1;
+
+    int optimal = e.nodes <= e.node_limit && !e.stopped;
+
+    free(order);
+    free(F);
+    free(e.A);
+    free(e.P);
+    free(e.Q);
+    free(e.T);
+    free(e.W);
+    free(e.S);
+    free(e.B);
+
+    return optimal;
+}
@@ -3,6 +3,20 @@
 #include <omp.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <math.h>
+
+// Clique partitions with more than m / CLIQUE_RATIO memberships are not used
+#define CLIQUE_RATIO 4
+#define CLIQUE_WORK_FACTOR 16
+#define CLIQUE_MIN_SIZE 8
+
+// Grid cells per box when building conflict graphs from boxes
+#define BOX_CELLS 2
+
+// Hubs are tracked with one bit each
+#define HUB_MAX 64
 
 static inline void parse_id(char *Data, size_t *p, long long *v)
 {
@@ -135,93 +149,106 @@ void graph_free(graph *g)
     free(g);
 }
 
-int graph_validate(graph *g)
+static inline int graph_has_edge(graph *g, int u, int v)
 {
-    long long *Edge_pos = malloc(sizeof(long long) * g->n);
-
-    long long M = 0;
-    for (int u = 0; u < g->n; u++)
+    long long l = g->V[u], r = g->V[u + 1];
+    while (l < r)
     {
-        Edge_pos[u] = g->V[u + 1];
+        long long mid = l + (r - l) / 2;
+        if (g->E[mid] < v)
+            l = mid + 1;
+        else
+            r = mid;
+    }
+    return l < g->V[u + 1] && g->E[l] == v;
+}
 
-        long long d_u = g->V[u + 1] - g->V[u];
-        if (d_u < 0)
+// Only the first error found is reported
+static void graph_report(int *reported, const char *format, ...)
+{
+#pragma omp critical(graph_report)
+    {
+        if (!*reported)
         {
-            fprintf(stderr, "Error in neighborhood list V: Vertex %d starts at position "
-                            "%lld and ends at position %lld\n",
-                    u + 1, g->V[u], g->V[u + 1]);
-            return 0;
+            va_list args;
+            va_start(args, format);
+            vfprintf(stderr, format, args);
+            va_end(args);
         }
+        *reported = 1;
+    }
+}
 
-        M += d_u;
+int graph_validate(graph *g)
+{
+    int valid = 1, reported = 0;
 
-        int first = 1;
-        for (long long i = g->V[u]; i < g->V[u + 1]; i++)
+#pragma omp parallel
+    {
+#pragma omp for reduction(&& : valid)
+        for (int u = 0; u < g->n; u++)
         {
-            if (i < 0 || i >= g->m)
+            if (g->V[u] < 0 || g->V[u + 1] < g->V[u] || g->V[u + 1] > g->m)
             {
-                fprintf(stderr, "Error in neighborhood list V: Vertex %d starts at position "
-                                "%lld and ends at position %lld\n",
-                        u + 1, g->V[u], g->V[u + 1]);
-                return 0;
-            }
-
-            int v = g->E[i];
-            if (v < 0 || v >= g->n)
-            {
-                fprintf(stderr, "Edge endpoint out of bounds for {%d,%d}\n", u + 1, v + 1);
-                return 0;
-            }
-            if (v == u)
-            {
-                fprintf(stderr, "Self edges are not allowd {%d,%d}\n", u + 1, u + 1);
-                return 0;
-            }
-            if (i > g->V[u] && v <= g->E[i - 1])
-            {
-                fprintf(stderr, "Unsorted neighborhood for vertex %d: {...,%d,%d,...}\n", u + 1, g->E[i - 1] + 1, v + 1);
-                return 0;
+                graph_report(&reported, "Error in neighborhood list V: Vertex %d starts at position "
+                                        "%lld and ends at position %lld\n",
+                             u + 1, g->V[u], g->V[u + 1]);
+                valid = 0;
             }
+        }
 
-            if (u > v)
+        if (valid)
+        {
+#pragma omp for reduction(&& : valid) schedule(dynamic, 1024)
+            for (int u = 0; u < g->n; u++)
             {
-                if (Edge_pos[v] >= g->V[v + 1] || g->E[Edge_pos[v]] != u)
+                for (long long i = g->V[u]; i < g->V[u + 1] && valid; i++)
                 {
-                    if (Edge_pos[v] >= g->V[v + 1] || g->E[Edge_pos[v]] > u)
-                        fprintf(stderr, "Undirected edge encountered: Found {%d,%d} but not {%d,%d}\n", u + 1, v + 1, v + 1, u + 1);
-                    else
-                        fprintf(stderr, "Undirected edge encountered: Found {%d,%d} but not {%d,%d}\n", v + 1, g->E[Edge_pos[v]] + 1, g->E[Edge_pos[v]] + 1, v + 1);
-                    return 0;
+                    int v = g->E[i];
+                    if (v < 0 || v >= g->n)
+                    {
+                        graph_report(&reported, "Edge endpoint out of bounds for {%d,%d}\n", u + 1, v + 1);
+                        valid = 0;
+                    }
+                    else if (v == u)
+                    {
+                        graph_report(&reported, "Self edges are not allowd {%d,%d}\n", u + 1, u + 1);
+                        valid = 0;
+                    }
+                    else if (i > g->V[u] && v <= g->E[i - 1])
+                    {
+                        graph_report(&reported, "Unsorted neighborhood for vertex %d: {...,%d,%d,...}\n", u + 1, g->E[i - 1] + 1, v + 1);
+                        valid = 0;
+                    }
                 }
-                Edge_pos[v]++;
-            }
-            else if (first)
-            {
-                Edge_pos[u] = i;
-                first = 0;
             }
         }
-    }
 
-    for (int u = 0; u < g->n; u++)
-    {
-        if (Edge_pos[u] != g->V[u + 1])
+        if (valid)
         {
-            int v = g->E[Edge_pos[u]];
-            fprintf(stderr, "Undirected edge encountered: Found {%d,%d} but not {%d,%d}\n", u + 1, v + 1, v + 1, u + 1);
-            return 0;
+#pragma omp for reduction(&& : valid) schedule(dynamic, 1024)
+            for (int u = 0; u < g->n; u++)
+            {
+                for (long long i = g->V[u]; i < g->V[u + 1] && valid; i++)
+                {
+                    int v = g->E[i];
+                    if (!graph_has_edge(g, v, u))
+                    {
+                        graph_report(&reported, "Undirected edge encountered: Found {%d,%d} but not {%d,%d}\n", u + 1, v + 1, v + 1, u + 1);
+                        valid = 0;
+                    }
+                }
+            }
         }
     }
 
-    if (M != g->V[g->n] || M != g->m)
+    if (valid && (g->V[g->n] - g->V[0] != g->m))
     {
-        fprintf(stderr, "Wrong edge count, found %lld, but file says %lld\n", M / 2, g->m / 2);
+        fprintf(stderr, "Wrong edge count, found %lld, but file says %lld\n", (g->V[g->n] - g->V[0]) / 2, g->m / 2);
         return 0;
     }
 
-    free(Edge_pos);
-
-    return 1;
+    return valid;
 }
 
 graph *graph_subgraph(graph *g, int *Mask, int *RM)
@@ -269,6 +296,7 @@ graph *graph_subgraph(graph *g, int *Mask, int *RM)
         }
     }
     sg->V[sg->n] = m;
+    sg->m = m;
 
     free(FM);
 
@@ -347,4 +375,834 @@ void graph_subgraph_par(graph *g, graph *sg, int *Mask, int *RM, int *FM, long l
         sg->V[sg->n] = m;
     }
 #pragma omp barrier
-}
\ No newline at end of file
+}
+
+typedef struct
+{
+    long long w;
+    int u;
+} graph_vertex;
+
+static int graph_vertex_compare(const void *a, const void *b)
+{
+    const graph_vertex *x = a, *y = b;
+    if (x->w != y->w)
+        return (x->w < y->w) - (x->w > y->w);
+    return (x->u > y->u) - (x->u < y->u);
+}
+
+static inline void graph_cover_add(int **clique, int **next, int *head, long long *alloc, long long *used, int v, int c)
+{
+    if (*used == *alloc)
+    {
+        *alloc *= 2;
+        *clique = realloc(*clique, sizeof(int) * *alloc);
+        *next = realloc(*next, sizeof(int) * *alloc);
+    }
+    (*clique)[*used] = c;
+    (*next)[*used] = head[v];
+    head[v] = (*used)++;
+}
+
+long long graph_clique_cover(graph *g, const int *stop)
+{
+    graph_vertex *order = malloc(sizeof(graph_vertex) * g->n);
+    for (int u = 0; u < g->n; u++)
+        order[u] = (graph_vertex){.w = g->W[u], .u = u};
+    qsort(order, g->n, sizeof(graph_vertex), graph_vertex_compare);
+
+    // Cliques of each vertex as linked lists, a vertex is only added to
+    // several cliques when its weight is not yet covered
+    long long alloc = g->n + 1, used = 0;
+    int *clique = malloc(sizeof(int) * alloc), *next = malloc(sizeof(int) * alloc);
+    int *head = malloc(sizeof(int) * g->n);
+    long long *CW = malloc(sizeof(long long) * g->n);
+    int *CS = malloc(sizeof(int) * g->n), *count = malloc(sizeof(int) * g->n), *T = malloc(sizeof(int) * g->n);
+    int k = 0;
+
+    for (int u = 0; u < g->n; u++)
+    {
+        head[u] = -1;
+        count[u] = 0;
+    }
+
+    long long bound = 0;
+    for (int i = 0; i < g->n; i++)
+    {
+        if ((i & ((1 << 10) - 1)) == 0 && stop != NULL)
+        {
+            int stopped;
+#pragma omp atomic read
+            stopped = *stop;
+            if (stopped)
+            {
+                bound = LLONG_MAX;
+                break;
+            }
+        }
+
+        int v = order[i].u, t = 0;
+        for (long long j = g->V[v]; j < g->V[v + 1]; j++)
+        {
+            for (int e = head[g->E[j]]; e >= 0; e = next[e])
+            {
+                if (count[clique[e]]++ == 0)
+                    T[t++] = clique[e];
+            }
+        }
+
+        long long r = g->W[v];
+        for (int j = 0; j < t; j++)
+        {
+            int c = T[j];
+            if (r > 0 && count[c] == CS[c])
+            {
+                graph_cover_add(&clique, &next, head, &alloc, &used, v, c);
+                CS[c]++;
+                r -= CW[c];
+            }
+            count[c] = 0;
+        }
+
+        if (r > 0)
+        {
+            CW[k] = r;
+            CS[k] = 1;
+            graph_cover_add(&clique, &next, head, &alloc, &used, v, k++);
+            bound += r;
+        }
+    }
+
+    free(order);
+    free(clique);
+    free(next);
+    free(head);
+    free(CW);
+    free(CS);
+    free(count);
+    free(T);
+
+    return bound;
+}
+
+typedef struct
+{
+    int d, gd, cells[2];
+    double min[2], size[2];
+    const double *lo, *hi;
+    long long *C; // Cell pointers
+    int *L;       // Boxes in each cell
+    int *R;       // Vertex of each box, boxes are stored in grid order
+} graph_box_grid;
+
+static inline int graph_box_cell(const graph_box_grid *G, int k, double x)
+{
+    int c = (int)((x - G->min[k]) / G->size[k]);
+    return c < 0 ? 0 : (c >= G->cells[k] ? G->cells[k] - 1 : c);
+}
+
+static inline int graph_box_empty(const graph_box_grid *G, int u)
+{
+    for (int k = 0; k < G->d; k++)
+        if (!(G->lo[(long long)u * G->d + k] < G->hi[(long long)u * G->d + k]))
+            return 1;
+    return 0;
+}
+
+static inline int graph_box_overlap(const graph_box_grid *G, int u, int v)
+{
+    const double *lu = G->lo + (long long)u * G->d, *hu = G->hi + (long long)u * G->d;
+    const double *lv = G->lo + (long long)v * G->d, *hv = G->hi + (long long)v * G->d;
+    for (int k = 0; k < G->d; k++)
+        if (!(lu[k] < hv[k] && lv[k] < hu[k]))
+            return 0;
+    return 1;
+}
+
+// Cells covered by box u, x0 to x1 in the first dimension and y0 to y1 in the second
+static inline void graph_box_range(const graph_box_grid *G, int u, int *x0, int *x1, int *y0, int *y1)
+{
+    const double *l = G->lo + (long long)u * G->d, *h = G->hi + (long long)u * G->d;
+    *x0 = graph_box_cell(G, 0, l[0]);
+    *x1 = graph_box_cell(G, 0, h[0]);
+    *y0 = G->gd > 1 ? graph_box_cell(G, 1, l[1]) : 0;
+    *y1 = G->gd > 1 ? graph_box_cell(G, 1, h[1]) : 0;
+}
+
+// Neighbors of u, stored in N if not NULL. A pair is only counted in the cell holding
+// the lower corner of its intersection, so each neighbor is found once
+static long long graph_box_neighbors(const graph_box_grid *G, int u, int *N)
+{
+    const double *lu = G->lo + (long long)u * G->d;
+    int x0, x1, y0, y1;
+    graph_box_range(G, u, &x0, &x1, &y0, &y1);
+
+    long long count = 0;
+    for (int x = x0; x <= x1; x++)
+    {
+        for (int y = y0; y <= y1; y++)
+        {
+            long long c = (long long)x * G->cells[1] + y;
+            for (long long i = G->C[c]; i < G->C[c + 1]; i++)
+            {
+                int v = G->L[i];
+                if (v == u || !graph_box_overlap(G, u, v))
+                    continue;
+
+                const double *lv = G->lo + (long long)v * G->d;
+                if (graph_box_cell(G, 0, lu[0] > lv[0] ? lu[0] : lv[0]) != x ||
+                    (G->gd > 1 && graph_box_cell(G, 1, lu[1] > lv[1] ? lu[1] : lv[1]) != y))
+                    continue;
+
+                if (N != NULL)
+                    N[count] = G->R[v];
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+// Turn the counts in A[1..n] into offsets, A[0] should be 0
+static void graph_box_prefix_sum(long long *A, long long n)
+{
+    long long *S = NULL;
+
+#pragma omp parallel
+    {
+        int tid = omp_get_thread_num(), nt = omp_get_num_threads();
+#pragma omp single
+        S = malloc(sizeof(long long) * (nt + 1));
+
+        long long chunk = (n + nt - 1) / nt;
+        long long start = 1 + chunk * tid, end = start + chunk > n + 1 ? n + 1 : start + chunk;
+
+        long long sum = 0;
+        for (long long i = start; i < end; i++)
+            sum += A[i];
+        S[tid + 1] = sum;
+
+#pragma omp barrier
+#pragma omp single
+        {
+            S[0] = 0;
+            for (int t = 0; t < nt; t++)
+                S[t + 1] += S[t];
+        }
+
+        sum = S[tid];
+        for (long long i = start; i < end; i++)
+        {
+            sum += A[i];
+            A[i] = sum;
+        }
+    }
+
+    free(S);
+}
+
+graph *graph_from_boxes(int n, int d, const double *lo, const double *hi, const long long *W)
+{
+    graph_box_grid G = {.d = d, .gd = d < 2 ? d : 2, .cells = {1, 1}, .lo = lo, .hi = hi};
+
+    // Grid bounds and cell sizes from the average box extent
+    for (int k = 0; k < G.gd; k++)
+    {
+        double min = INFINITY, max = -INFINITY, extent = 0.0;
+        long long count = 0;
+#pragma omp parallel for reduction(min : min) reduction(max : max) reduction(+ : extent, count)
+        for (int u = 0; u < n; u++)
+        {
+            if (graph_box_empty(&G, u))
+                continue;
+            double l = lo[(long long)u * d + k], h = hi[(long long)u * d + k];
+            min = l < min ? l : min;
+            max = h > max ? h : max;
+            extent += h - l;
+            count++;
+        }
+
+        G.min[k] = count > 0 ? min : 0.0;
+        double range = count > 0 ? max - min : 1.0, size = count > 0 ? extent / count : 1.0;
+        double cells = range / size;
+        G.cells[k] = cells < 1.0 ? 1 : (cells > n ? n : (int)cells);
+        G.size[k] = range > 0.0 ? range / G.cells[k] : 1.0;
+    }
+
+    // Coarser cells if there are many more cells than boxes
+    while ((long long)G.cells[0] * G.cells[1] > (long long)BOX_CELLS * n + 1)
+    {
+        for (int k = 0; k < G.gd; k++)
+        {
+            G.cells[k] = (G.cells[k] + 1) / 2;
+            G.size[k] *= 2.0;
+        }
+    }
+
+    long long cells = (long long)G.cells[0] * G.cells[1];
+    G.C = calloc(cells + 1, sizeof(long long));
+
+    // Non-empty boxes grouped by the cell of their lower corner, so candidates
+    // from the same cell are close in memory
+    int k = 0;
+#pragma omp parallel for reduction(+ : k)
+    for (int u = 0; u < n; u++)
+    {
+        if (graph_box_empty(&G, u))
+            continue;
+        int x0, x1, y0, y1;
+        graph_box_range(&G, u, &x0, &x1, &y0, &y1);
+#pragma omp atomic
+        G.C[(long long)x0 * G.cells[1] + y0 + 1]++;
+        k++;
+    }
+    graph_box_prefix_sum(G.C, cells);
+
+    G.R = malloc(sizeof(int) * (k + 1));
+#pragma omp parallel for
+    for (int u = 0; u < n; u++)
+    {
+        if (graph_box_empty(&G, u))
+            continue;
+        int x0, x1, y0, y1;
+        graph_box_range(&G, u, &x0, &x1, &y0, &y1);
+        long long p;
+#pragma omp atomic capture
+        p = G.C[(long long)x0 * G.cells[1] + y0]++;
+        G.R[p] = u;
+    }
+
+    double *BL = malloc(sizeof(double) * ((long long)k * d + 1));
+    double *BH = malloc(sizeof(double) * ((long long)k * d + 1));
+#pragma omp parallel for
+    for (int i = 0; i < k; i++)
+    {
+        for (int j = 0; j < d; j++)
+        {
+            BL[(long long)i * d + j] = lo[(long long)G.R[i] * d + j];
+            BH[(long long)i * d + j] = hi[(long long)G.R[i] * d + j];
+        }
+    }
+    G.lo = BL;
+    G.hi = BH;
+
+    // Boxes in each cell they cover, the order within a cell does not matter
+#pragma omp parallel for
+    for (long long c = 0; c <= cells; c++)
+        G.C[c] = 0;
+
+#pragma omp parallel for
+    for (int i = 0; i < k; i++)
+    {
+        int x0, x1, y0, y1;
+        graph_box_range(&G, i, &x0, &x1, &y0, &y1);
+        for (int x = x0; x <= x1; x++)
+            for (int y = y0; y <= y1; y++)
+            {
+#pragma omp atomic
+                G.C[(long long)x * G.cells[1] + y + 1]++;
+            }
+    }
+    graph_box_prefix_sum(G.C, cells);
+
+    G.L = malloc(sizeof(int) * (G.C[cells] + 1));
+    long long *P = malloc(sizeof(long long) * (cells + 1));
+
+#pragma omp parallel for
+    for (long long c = 0; c <= cells; c++)
+        P[c] = G.C[c];
+
+#pragma omp parallel for
+    for (int i = 0; i < k; i++)
+    {
+        int x0, x1, y0, y1;
+        graph_box_range(&G, i, &x0, &x1, &y0, &y1);
+        for (int x = x0; x <= x1; x++)
+            for (int y = y0; y <= y1; y++)
+            {
+                long long p;
+#pragma omp atomic capture
+                p = P[(long long)x * G.cells[1] + y]++;
+                G.L[p] = i;
+            }
+    }
+    free(P);
+
+    graph *g = malloc(sizeof(graph));
+    g->n = n;
+    g->V = malloc(sizeof(long long) * (n + 1));
+    g->W = malloc(sizeof(long long) * n);
+
+#pragma omp parallel for
+    for (int u = 0; u < n; u++)
+    {
+        g->V[u + 1] = 0;
+        g->W[u] = W[u];
+    }
+    g->V[0] = 0;
+
+    // Count the neighbors, then store them in a second pass
+#pragma omp parallel for schedule(dynamic, 256)
+    for (int i = 0; i < k; i++)
+        g->V[G.R[i] + 1] = graph_box_neighbors(&G, i, NULL);
+
+    graph_box_prefix_sum(g->V, n);
+    g->m = g->V[n];
+    g->E = malloc(sizeof(int) * (g->m + 1));
+
+#pragma omp parallel for schedule(dynamic, 256)
+    for (int i = 0; i < k; i++)
+    {
+        int u = G.R[i];
+        graph_box_neighbors(&G, i, g->E + g->V[u]);
+        qsort(g->E + g->V[u], g->V[u + 1] - g->V[u], sizeof(int), graph_compare);
+    }
+
+    free(G.C);
+    free(G.L);
+    free(G.R);
+    free(BL);
+    free(BH);
+
+    return g;
+}
+
+static inline int graph_covered(const uint64_t *B, long long i)
+{
+    return (B[i >> 6] >> (i & 63)) & 1;
+}
+
+graph_cliques *graph_clique_partition(graph *g)
+{
+    // Bit i is set once edge g->E[i] is in a clique
+    uint64_t *B = calloc((g->m >> 6) + 1, sizeof(uint64_t));
+    int *count = calloc(g->n, sizeof(int)), *member = calloc(g->n, sizeof(int));
+    int *L = malloc(sizeof(int) * g->n);
+
+    // Memberships as (vertex, clique) pairs, sorted by vertex below
+    long long alloc = g->n + 1, used = 0, limit = g->m / CLIQUE_RATIO, work = 0;
+    int *PU = malloc(sizeof(int) * alloc), *PK = malloc(sizeof(int) * alloc);
+    int k = 0, failed = 0;
+
+    // Large cliques first, so a few edges to other cliques can not split them
+    for (int round = 0; round < 2 && !failed; round++)
+    {
+        int min_size = round == 0 ? CLIQUE_MIN_SIZE : 2;
+        for (int u = 0; u < g->n && !failed; u++)
+        {
+            for (long long i = g->V[u]; i < g->V[u + 1] && !failed; i++)
+            {
+                if (graph_covered(B, i))
+                    continue;
+
+                // Grow a clique from the uncovered edge {u, E[i]}, count is the number
+                // of clique members a vertex has uncovered edges to. Candidates that
+                // fail once can not catch up, so one pass over u's edges is enough
+                int size = 0;
+                for (long long j = i; j < g->V[u + 1]; j++)
+                {
+                    int v = g->E[j];
+                    if (j > i && (graph_covered(B, j) || count[v] < size))
+                        continue;
+
+                    if (size == 0)
+                    {
+                        L[size++] = u;
+                        member[u] = 1;
+                        for (long long l = g->V[u]; l < g->V[u + 1]; l++)
+                            if (!graph_covered(B, l))
+                                count[g->E[l]]++;
+                        work += g->V[u + 1] - g->V[u];
+                    }
+
+                    L[size++] = v;
+                    member[v] = 1;
+                    for (long long l = g->V[v]; l < g->V[v + 1]; l++)
+                        if (!graph_covered(B, l))
+                            count[g->E[l]]++;
+                    work += g->V[v + 1] - g->V[v];
+                }
+
+                int keep = size >= min_size;
+                if (keep && used + size > limit)
+                    failed = 1;
+                if (work > CLIQUE_WORK_FACTOR * g->m)
+                    failed = 1;
+
+                if (keep && used + size > alloc)
+                {
+                    alloc = (used + size) * 2;
+                    PU = realloc(PU, sizeof(int) * alloc);
+                    PK = realloc(PK, sizeof(int) * alloc);
+                }
+
+                for (int j = 0; j < size; j++)
+                {
+                    int v = L[j];
+                    for (long long l = g->V[v]; l < g->V[v + 1]; l++)
+                    {
+                        if (graph_covered(B, l))
+                            continue;
+                        count[g->E[l]] = 0;
+                        if (keep && member[g->E[l]])
+                            B[l >> 6] |= 1ull << (l & 63);
+                    }
+                    if (keep)
+                    {
+                        PU[used] = v;
+                        PK[used++] = k;
+                    }
+                }
+                for (int j = 0; j < size; j++)
+                    member[L[j]] = 0;
+                k += keep;
+            }
+        }
+    }
+
+    free(B);
+    free(count);
+    free(member);
+    free(L);
+
+    if (failed)
+    {
+        free(PU);
+        free(PK);
+        return NULL;
+    }
+
+    graph_cliques *K = malloc(sizeof(graph_cliques));
+    K->k = k;
+    K->V = calloc(g->n + 1, sizeof(long long));
+    K->E = malloc(sizeof(int) * (used + 1));
+
+    for (long long i = 0; i < used; i++)
+        K->V[PU[i] + 1]++;
+    for (int u = 0; u < g->n; u++)
+        K->V[u + 1] += K->V[u];
+
+    long long *P = malloc(sizeof(long long) * (g->n + 1));
+    for (int u = 0; u <= g->n; u++)
+        P[u] = K->V[u];
+    for (long long i = 0; i < used; i++)
+        K->E[P[PU[i]]++] = PK[i];
+
+    free(P);
+    free(PU);
+    free(PK);
+
+    return K;
+}
+
+void graph_cliques_free(graph_cliques *K)
+{
+    if (K == NULL)
+        return;
+
+    free(K->V);
+    free(K->E);
+
+    free(K);
+}
+
+graph_neighbor *graph_interleave(graph *g)
+{
+    int fits = 1;
+#pragma omp parallel for reduction(&& : fits)
+    for (int u = 0; u < g->n; u++)
+        fits = fits && g->W[u] >= INT_MIN && g->W[u] <= INT_MAX;
+
+    if (!fits)
+        return NULL;
+
+    graph_neighbor *N = malloc(sizeof(graph_neighbor) * (g->m + 1));
+
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (int u = 0; u < g->n; u++)
+        for (long long i = g->V[u]; i < g->V[u + 1]; i++)
+            N[i] = (graph_neighbor){.v = g->E[i], .w = g->W[g->E[i]]};
+
+    return N;
+}
+
+static int graph_hub_compare(const void *a, const void *b)
+{
+    const long long *x = a, *y = b;
+    if (x[0] != y[0])
+        return (x[0] < y[0]) - (x[0] > y[0]);
+    return (x[1] > y[1]) - (x[1] < y[1]);
+}
+
+graph_hubs *graph_hubs_init(graph *g, int min_degree)
+{
+    if (min_degree < 1)
+        min_degree = 1;
+
+    long long k = 0;
+#pragma omp parallel for reduction(+ : k)
+    for (int u = 0; u < g->n; u++)
+        k += g->V[u + 1] - g->V[u] >= min_degree;
+
+    if (k == 0)
+        return NULL;
+
+    // Candidates as (degree, vertex) pairs
+    long long *D = malloc(sizeof(long long) * 2 * k);
+    k = 0;
+    for (int u = 0; u < g->n; u++)
+    {
+        if (g->V[u + 1] - g->V[u] < min_degree)
+            continue;
+        D[2 * k] = g->V[u + 1] - g->V[u];
+        D[2 * k + 1] = u;
+        k++;
+    }
+
+    qsort(D, k, sizeof(long long) * 2, graph_hub_compare);
+    if (k > HUB_MAX)
+        k = HUB_MAX;
+
+    graph_hubs *H = malloc(sizeof(graph_hubs));
+    H->k = k;
+    H->H = malloc(sizeof(int) * k);
+    H->index = malloc(sizeof(int) * g->n);
+    H->mask = malloc(sizeof(uint64_t) * g->n);
+
+#pragma omp parallel for
+    for (int u = 0; u < g->n; u++)
+    {
+        H->index[u] = -1;
+        H->mask[u] = 0;
+    }
+
+    for (int i = 0; i < k; i++)
+    {
+        int h = D[2 * i + 1];
+        H->H[i] = h;
+        H->index[h] = i;
+
+#pragma omp parallel for
+        for (long long j = g->V[h]; j < g->V[h + 1]; j++)
+            H->mask[g->E[j]] |= 1ull << i;
+    }
+    free(D);
+
+    return H;
+}
+
+void graph_hubs_free(graph_hubs *H)
+{
+    if (H == NULL)
+        return;
+
+    free(H->H);
+    free(H->index);
+    free(H->mask);
+
+    free(H);
+}
+
+static inline int graph_find(int *P, int u)
+{
+    int p = __atomic_load_n(&P[u], __ATOMIC_RELAXED);
+    while (p != u)
+    {
+        u = p;
+        p = __atomic_load_n(&P[u], __ATOMIC_RELAXED);
+    }
+    return u;
+}
+
+int graph_components_par(graph *g, int *C)
+{
+    int *P = malloc(sizeof(int) * g->n);
+    int k = 0;
+
+#pragma omp parallel
+    {
+#pragma omp for
+        for (int u = 0; u < g->n; u++)
+            P[u] = u;
+
+        // Union-find, the larger root is always linked below the smaller one
+#pragma omp for schedule(dynamic, 1024)
+        for (int u = 0; u < g->n; u++)
+        {
+            for (long long i = g->V[u]; i < g->V[u + 1]; i++)
+            {
+                int v = g->E[i];
+                if (v < u)
+                    continue;
+
+                int ru = graph_find(P, u), rv = graph_find(P, v);
+                while (ru != rv)
+                {
+                    if (ru < rv)
+                    {
+                        int t = ru;
+                        ru = rv;
+                        rv = t;
+                    }
+                    if (__atomic_compare_exchange_n(&P[ru], &ru, rv, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                        break;
+                    ru = graph_find(P, ru);
+                    rv = graph_find(P, rv);
+                }
+            }
+        }
+
+#pragma omp for
+        for (int u = 0; u < g->n; u++)
+            __atomic_store_n(&P[u], graph_find(P, u), __ATOMIC_RELAXED);
+
+        // Number the components by their smallest vertex
+#pragma omp single
+        for (int u = 0; u < g->n; u++)
+            if (P[u] == u)
+                C[u] = k++;
+
+#pragma omp for
+        for (int u = 0; u < g->n; u++)
+            if (P[u] != u)
+                C[u] = C[P[u]];
+    }
+
+    free(P);
+
+    return k;
+}
+
+typedef struct
+{
+    int u, v, d;
+    long long i;
+} graph_change;
+
+static int graph_change_compare(const void *a, const void *b)
+{
+    const graph_change *x = a, *y = b;
+    if (x->u != y->u)
+        return x->u < y->u ? -1 : 1;
+    if (x->v != y->v)
+        return x->v < y->v ? -1 : 1;
+    return (x->i > y->i) - (x->i < y->i);
+}
+
+long long graph_update(graph *g, graph *ng, int n, const int *X, const int *Y, const int *D, long long k, int *U)
+{
+    graph_change *L = malloc(sizeof(graph_change) * (2 * k + 1));
+
+    long long l = 0;
+    for (long long i = 0; i < k; i++)
+    {
+        if (X[i] < 0 || X[i] >= n || Y[i] < 0 || Y[i] >= n || X[i] == Y[i])
+        {
+            fprintf(stderr, "Invalid edge update {%d,%d} in graph with %d vertices\n", X[i], Y[i], n);
+            continue;
+        }
+        L[l++] = (graph_change){.u = X[i], .v = Y[i], .d = D[i] > 0, .i = i};
+        L[l++] = (graph_change){.u = Y[i], .v = X[i], .d = D[i] > 0, .i = i};
+    }
+
+    qsort(L, l, sizeof(graph_change), graph_change_compare);
+
+    // Keep the last change to each edge, and the changed vertices
+    long long p = 0, nu = 0;
+    for (long long i = 0; i < l; i++)
+    {
+        if (i + 1 < l && L[i + 1].u == L[i].u && L[i + 1].v == L[i].v)
+            continue;
+        if (nu == 0 || U[nu - 1] != L[i].u)
+            U[nu++] = L[i].u;
+        L[p++] = L[i];
+    }
+
+    // Start of the changes to each vertex, in the same order as U
+    long long *S = malloc(sizeof(long long) * (nu + 1));
+    for (long long i = 0, j = 0; i < p; i++)
+        if (i == 0 || L[i].u != L[i - 1].u)
+            S[j++] = i;
+    S[nu] = p;
+
+    int *C = malloc(sizeof(int) * (n + 1));
+    long long *V = malloc(sizeof(long long) * (n + 1));
+    long long *W = malloc(sizeof(long long) * n);
+
+#pragma omp parallel
+    {
+#pragma omp for
+        for (int u = 0; u < n; u++)
+        {
+            C[u] = -1;
+            W[u] = u < g->n ? g->W[u] : 0;
+            V[u + 1] = u < g->n ? g->V[u + 1] - g->V[u] : 0;
+        }
+
+        // Merge the sorted neighborhoods with the sorted changes to count the new degrees
+#pragma omp for
+        for (long long j = 0; j < nu; j++)
+        {
+            int u = U[j];
+            C[u] = j;
+
+            long long i1 = u < g->n ? g->V[u] : 0, e1 = u < g->n ? g->V[u + 1] : 0;
+            long long i2 = S[j], degree = 0;
+            while (i1 < e1 || i2 < S[j + 1])
+            {
+                if (i2 == S[j + 1] || (i1 < e1 && g->E[i1] < L[i2].v))
+                    degree++, i1++;
+                else if (i1 == e1 || L[i2].v < g->E[i1])
+                    degree += L[i2++].d;
+                else
+                    degree += L[i2++].d, i1++;
+            }
+            V[u + 1] = degree;
+        }
+    }
+
+    V[0] = 0;
+    for (int u = 0; u < n; u++)
+        V[u + 1] += V[u];
+
+    int *E = malloc(sizeof(int) * (V[n] + 1));
+
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (int u = 0; u < n; u++)
+    {
+        long long i1 = u < g->n ? g->V[u] : 0, e1 = u < g->n ? g->V[u + 1] : 0, o = V[u];
+        if (C[u] < 0)
+        {
+            for (; i1 < e1; i1++)
+                E[o++] = g->E[i1];
+            continue;
+        }
+
+        long long i2 = S[C[u]], e2 = S[C[u] + 1];
+        while (i1 < e1 || i2 < e2)
+        {
+            if (i2 == e2 || (i1 < e1 && g->E[i1] < L[i2].v))
+                E[o++] = g->E[i1++];
+            else if (i1 == e1 || L[i2].v < g->E[i1])
+            {
+                if (L[i2].d)
+                    E[o++] = L[i2].v;
+                i2++;
+            }
+            else
+            {
+                if (L[i2].d)
+                    E[o++] = L[i2].v;
+                i1++, i2++;
+            }
+        }
+    }
+
+    *ng = (graph){.n = n, .m = V[n], .V = V, .E = E, .W = W};
+
+    free(L);
+    free(S);
+    free(C);
+
+    return nu;
+}
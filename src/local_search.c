@@ -9,35 +9,92 @@
 #define MAX_TWO_ONE_DEGREE (1 << 8)
 #define AAP_LIMIT (1 << 19)
 #define DEFAULT_QUEUE_SIZE 32
+#define PRIORITY_ROUNDS 64
+#define HUB_QUEUE (1 << 14)
+#define PREFETCH_DISTANCE 8
+#define PREFETCH_LINE 16
+#define PREFETCH_NEIGHBORS 32
 
-local_search *local_search_init(graph *g, unsigned int seed)
+local_search *local_search_init_lazy(graph *g, unsigned int seed)
 {
     local_search *ls = malloc(sizeof(local_search));
 
-    ls->independent_set = malloc(sizeof(int) * g->n);
+    // Zeroed memory is left to the OS, pages are only touched when used
+    ls->independent_set = calloc(g->n, sizeof(int));
 
     ls->queue = malloc(sizeof(int) * g->n);
-    ls->in_queue = malloc(sizeof(int) * g->n);
-    ls->prev_queue = malloc(sizeof(int) * g->n);
-    ls->in_prev_queue = malloc(sizeof(int) * g->n);
+    ls->in_queue = calloc(g->n, sizeof(int));
+    ls->prev_queue = calloc(g->n, sizeof(int));
+    ls->in_prev_queue = calloc(g->n, sizeof(int));
 
     ls->max_queue = DEFAULT_QUEUE_SIZE;
-    ls->adjacent_weight = malloc(sizeof(long long) * g->n);
-    ls->tabu = malloc(sizeof(int) * g->n);
-    ls->tightness = malloc(sizeof(int) * g->n);
-    ls->temp = malloc(sizeof(int) * g->n * 2);
-    ls->mask = malloc(sizeof(int) * g->n);
+    ls->adjacent_weight = calloc(g->n, sizeof(long long));
+    ls->tabu = calloc(g->n, sizeof(int));
+    ls->tightness = calloc(g->n, sizeof(int));
+    ls->temp = calloc((size_t)g->n * 2, sizeof(int));
+    ls->mask = calloc(g->n, sizeof(int));
 
     ls->log_alloc = g->n;
     ls->log = malloc(sizeof(int) * ls->log_alloc);
 
     ls->seed = seed;
 
-    local_search_reset(g, ls);
+    ls->work = 0;
+    ls->work_limit = LLONG_MAX;
+    ls->deadline = INFINITY;
+    ls->stop_weight = LLONG_MAX;
+    ls->stall_time = INFINITY;
+    ls->stall_iterations = LLONG_MAX;
+    ls->stalled = 0;
+
+    ls->control = NULL;
+    ls->report = 1;
+
+    ls->cliques = NULL;
+    ls->occupant = NULL;
+    ls->clique_mask = NULL;
+
+    ls->hubs = NULL;
+    ls->hub_active = 0;
+    ls->hub_locked = 0;
+    ls->hub_cursor = NULL;
+
+    ls->neighbors = NULL;
+
+    ls->cost = 0;
+    ls->size = 0;
+    ls->time = 0.0;
+    ls->time_ref = omp_get_wtime();
+
+    ls->queue_count = 0;
+    ls->prev_queue_start = 0;
+    ls->prev_queue_count = 0;
+
+    ls->log_count = 0;
+    ls->log_enabled = 0;
 
     return ls;
 }
 
+local_search *local_search_init(graph *g, unsigned int seed)
+{
+    local_search *ls = local_search_init_lazy(g, seed);
+    local_search_queue_all(g, ls);
+    return ls;
+}
+
+void local_search_queue_all(graph *g, local_search *ls)
+{
+    for (int u = 0; u < g->n; u++)
+    {
+        if (!ls->in_queue[u])
+        {
+            ls->in_queue[u] = 1;
+            ls->queue[ls->queue_count++] = u;
+        }
+    }
+}
+
 void local_search_free(local_search *ls)
 {
     if (ls == NULL)
@@ -57,6 +114,9 @@ void local_search_free(local_search *ls)
     free(ls->mask);
 
     free(ls->log);
+    free(ls->occupant);
+    free(ls->clique_mask);
+    free(ls->hub_cursor);
 
     free(ls);
 }
@@ -69,6 +129,8 @@ void local_search_reset(graph *g, local_search *ls)
     ls->time_ref = omp_get_wtime();
 
     ls->queue_count = g->n;
+    ls->prev_queue_start = 0;
+    ls->prev_queue_count = 0;
 
     ls->log_count = 0;
     ls->log_enabled = 0;
@@ -87,6 +149,367 @@ void local_search_reset(graph *g, local_search *ls)
         ls->temp[u] = 0;
         ls->mask[u] = 0;
     }
+
+    if (ls->cliques != NULL)
+        for (int c = 0; c < ls->cliques->k; c++)
+            ls->occupant[c] = -1;
+
+    ls->hub_active = 0;
+    ls->hub_locked = 0;
+}
+
+void local_search_rebuild_par(graph *g, local_search *ls)
+{
+#pragma omp single
+    {
+        ls->cost = 0;
+        ls->size = 0;
+        ls->queue_count = g->n;
+        ls->prev_queue_start = 0;
+        ls->prev_queue_count = 0;
+        ls->log_count = 0;
+        ls->log_enabled = 0;
+
+        ls->hub_active = 0;
+        ls->hub_locked = 0;
+        if (ls->hubs != NULL)
+            for (int i = 0; i < ls->hubs->k; i++)
+                if (ls->independent_set[ls->hubs->H[i]])
+                    ls->hub_active |= 1ull << i;
+    }
+
+    long long cost = 0;
+    int size = 0;
+
+    const graph_cliques *K = ls->cliques;
+    if (K != NULL)
+    {
+#pragma omp for
+        for (int c = 0; c < K->k; c++)
+            ls->occupant[c] = -1;
+    }
+
+#pragma omp for nowait
+    for (int u = 0; u < g->n; u++)
+    {
+        long long adjacent_weight = 0;
+        int tightness = 0;
+        if (K == NULL)
+        {
+            for (long long i = g->V[u]; i < g->V[u + 1]; i++)
+            {
+                int v = g->E[i];
+                if (ls->independent_set[v] && !local_search_is_hub(ls, v))
+                {
+                    adjacent_weight += local_search_neighbor_weight(g, ls, i);
+                    tightness++;
+                }
+            }
+        }
+        else if (ls->independent_set[u])
+        {
+            // Only one vertex per clique in a valid solution
+            for (long long i = K->V[u]; i < K->V[u + 1]; i++)
+            {
+#pragma omp atomic write
+                ls->occupant[K->E[i]] = u;
+            }
+        }
+
+        if (ls->independent_set[u])
+        {
+            cost += g->W[u];
+            size++;
+        }
+
+        ls->queue[u] = u;
+        ls->in_queue[u] = 1;
+        ls->prev_queue[u] = 0;
+        ls->in_prev_queue[u] = 0;
+
+        ls->adjacent_weight[u] = adjacent_weight;
+        ls->tabu[u] = 0;
+        ls->tightness[u] = tightness;
+        ls->temp[u] = 0;
+        ls->mask[u] = 0;
+    }
+
+#pragma omp atomic
+    ls->cost += cost;
+#pragma omp atomic
+    ls->size += size;
+
+#pragma omp barrier
+}
+
+void local_search_grow(local_search *ls, int old_n, int n)
+{
+    if (n <= old_n)
+        return;
+
+    ls->independent_set = realloc(ls->independent_set, sizeof(int) * n);
+    ls->queue = realloc(ls->queue, sizeof(int) * n);
+    ls->in_queue = realloc(ls->in_queue, sizeof(int) * n);
+    ls->prev_queue = realloc(ls->prev_queue, sizeof(int) * n);
+    ls->in_prev_queue = realloc(ls->in_prev_queue, sizeof(int) * n);
+
+    ls->adjacent_weight = realloc(ls->adjacent_weight, sizeof(long long) * n);
+    ls->tabu = realloc(ls->tabu, sizeof(int) * n);
+    ls->tightness = realloc(ls->tightness, sizeof(int) * n);
+    ls->temp = realloc(ls->temp, sizeof(int) * n * 2);
+    ls->mask = realloc(ls->mask, sizeof(int) * n);
+
+    for (int u = old_n; u < n; u++)
+    {
+        ls->independent_set[u] = 0;
+        ls->queue[ls->queue_count++] = u;
+        ls->in_queue[u] = 1;
+        ls->prev_queue[u] = 0;
+        ls->in_prev_queue[u] = 0;
+
+        ls->adjacent_weight[u] = 0;
+        ls->tabu[u] = 0;
+        ls->tightness[u] = 0;
+        ls->temp[u] = 0;
+        ls->mask[u] = 0;
+    }
+}
+
+// Mark u for recomputation, the marked vertices are listed in temp
+static inline void local_search_touch(local_search *ls, int u, int *count)
+{
+    if (ls->mask[u])
+        return;
+    ls->mask[u] = 1;
+    ls->temp[(*count)++] = u;
+}
+
+void local_search_update(graph *old, graph *g, local_search *ls, const int *U, long long nu, const int *C, long long nc)
+{
+    // The cliques, hubs and interleaved adjacency belong to the old graph
+    ls->neighbors = NULL;
+    if (ls->cliques != NULL)
+        local_search_set_cliques(old, ls, NULL);
+    if (ls->hubs != NULL)
+        local_search_set_hubs(old, ls, NULL);
+
+    local_search_grow(ls, old->n, g->n);
+
+    ls->log_count = 0;
+    ls->log_enabled = 0;
+
+    for (long long i = 0; i < nc; i++)
+    {
+        int u = C[i];
+        if (u < old->n && ls->independent_set[u])
+            ls->cost += g->W[u] - old->W[u];
+    }
+
+    int count = 0;
+
+    // New edges may connect two vertices in the solution, keep the heavier one
+    for (long long i = 0; i < nu; i++)
+    {
+        int u = U[i];
+        local_search_touch(ls, u, &count);
+        for (long long j = g->V[u]; j < g->V[u + 1] && ls->independent_set[u]; j++)
+        {
+            int v = g->E[j];
+            if (!ls->independent_set[v])
+                continue;
+
+            int x = g->W[v] < g->W[u] || (g->W[v] == g->W[u] && v > u) ? v : u;
+            ls->independent_set[x] = 0;
+            ls->cost -= g->W[x];
+            ls->size--;
+
+            for (long long l = g->V[x]; l < g->V[x + 1]; l++)
+                local_search_touch(ls, g->E[l], &count);
+            local_search_touch(ls, x, &count);
+        }
+    }
+
+    for (long long i = 0; i < nc; i++)
+    {
+        int u = C[i];
+        local_search_touch(ls, u, &count);
+        if (!ls->independent_set[u])
+            continue;
+
+        for (long long j = g->V[u]; j < g->V[u + 1]; j++)
+            local_search_touch(ls, g->E[j], &count);
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        int u = ls->temp[i];
+        ls->mask[u] = 0;
+
+        ls->adjacent_weight[u] = 0;
+        ls->tightness[u] = 0;
+        for (long long j = g->V[u]; j < g->V[u + 1]; j++)
+        {
+            int v = g->E[j];
+            if (ls->independent_set[v])
+            {
+                ls->adjacent_weight[u] += g->W[v];
+                ls->tightness[u]++;
+            }
+        }
+
+        if (!ls->in_queue[u])
+        {
+            ls->in_queue[u] = 1;
+            ls->queue[ls->queue_count++] = u;
+        }
+    }
+
+    local_search_greedy(g, ls);
+}
+
+void local_search_set_solution_par(graph *g, local_search *ls, const int *I)
+{
+#pragma omp for
+    for (int u = 0; u < g->n; u++)
+    {
+        int keep = I[u] != 0;
+        for (long long i = g->V[u]; i < g->V[u + 1] && keep; i++)
+        {
+            int v = g->E[i];
+            if (I[v] && (g->W[v] > g->W[u] || (g->W[v] == g->W[u] && v < u)))
+                keep = 0;
+        }
+        ls->independent_set[u] = keep;
+    }
+
+    local_search_rebuild_par(g, ls);
+}
+
+static inline unsigned int local_search_hash(unsigned int x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352d;
+    x ^= x >> 15;
+    x *= 0x846ca68b;
+    x ^= x >> 16;
+    return x;
+}
+
+// Higher weight to degree ratio first, then a fixed random order
+static inline int local_search_priority_before(graph *g, int u, int v)
+{
+    double pu = (double)g->W[u] / (double)(g->V[u + 1] - g->V[u] + 1);
+    double pv = (double)g->W[v] / (double)(g->V[v + 1] - g->V[v] + 1);
+    if (pu != pv)
+        return pu > pv;
+
+    unsigned int hu = local_search_hash(u), hv = local_search_hash(v);
+    return hu > hv || (hu == hv && u < v);
+}
+
+void local_search_priority_par(graph *g, local_search *ls, long long *S)
+{
+    int tid = omp_get_thread_num(), nt = omp_get_num_threads();
+
+    // mask is 0 for undecided vertices, 1 in the solution, and 2 left out
+#pragma omp for
+    for (int u = 0; u < g->n; u++)
+    {
+        ls->mask[u] = 0;
+        ls->temp[u] = 0;
+    }
+
+    long long undecided = g->n;
+    for (int r = 0; r < PRIORITY_ROUNDS && undecided > 0; r++)
+    {
+#pragma omp for
+        for (int u = 0; u < g->n; u++)
+        {
+            if (ls->mask[u])
+                continue;
+
+            int state = 1;
+            for (long long i = g->V[u]; i < g->V[u + 1]; i++)
+            {
+                int v = g->E[i];
+                if (ls->mask[v] == 1)
+                {
+                    state = 2;
+                    break;
+                }
+                if (ls->mask[v] == 0 && local_search_priority_before(g, v, u))
+                    state = 0;
+            }
+            ls->temp[u] = state;
+        }
+
+        long long count = 0;
+#pragma omp for
+        for (int u = 0; u < g->n; u++)
+        {
+            if (ls->mask[u])
+                continue;
+
+            ls->mask[u] = ls->temp[u];
+            ls->temp[u] = 0;
+            count += ls->mask[u] == 0;
+        }
+
+        S[tid] = count;
+#pragma omp barrier
+
+        undecided = 0;
+        for (int i = 0; i < nt; i++)
+            undecided += S[i];
+#pragma omp barrier
+    }
+
+    // Vertices still undecided are left to greedy
+#pragma omp for
+    for (int u = 0; u < g->n; u++)
+        ls->independent_set[u] = ls->mask[u] == 1;
+
+    local_search_rebuild_par(g, ls);
+}
+
+void local_search_copy(local_search *dst, local_search *src, int n)
+{
+    for (int i = dst->prev_queue_start; i < dst->prev_queue_count; i++)
+        dst->in_prev_queue[dst->prev_queue[i]] = 0;
+    dst->prev_queue_start = 0;
+    dst->prev_queue_count = 0;
+
+    for (int u = 0; u < n; u++)
+    {
+        dst->independent_set[u] = src->independent_set[u];
+        dst->queue[u] = src->queue[u];
+        dst->in_queue[u] = src->in_queue[u];
+        dst->adjacent_weight[u] = src->adjacent_weight[u];
+        dst->tightness[u] = src->tightness[u];
+    }
+
+    if (src->cliques != NULL)
+        for (int c = 0; c < src->cliques->k; c++)
+            dst->occupant[c] = src->occupant[c];
+    dst->hub_active = src->hub_active;
+
+    dst->queue_count = src->queue_count;
+
+    // What src left of a greedy pass is queued in dst
+    for (int i = src->prev_queue_start; i < src->prev_queue_count; i++)
+    {
+        int u = src->prev_queue[i];
+        if (!dst->in_queue[u])
+        {
+            dst->in_queue[u] = 1;
+            dst->queue[dst->queue_count++] = u;
+        }
+    }
+
+    dst->cost = src->cost;
+    dst->size = src->size;
+    dst->time = src->time;
+    dst->time_ref = src->time_ref;
 }
 
 static inline void local_search_shuffle(int *list, int n, unsigned int *seed)
@@ -104,14 +527,111 @@ void local_search_in_order_solution(graph *g, local_search *ls)
 {
     for (int u = 0; u < g->n; u++)
     {
-        if (!ls->tabu[u] && ls->adjacent_weight[u] < g->W[u])
+        // The rest stay queued for greedy
+        if ((u & ((1 << 10) - 1)) == 0 && local_search_stopped(ls))
+            break;
+
+        if (!local_search_tabu(ls, u) && local_search_adjacent_weight(g, ls, u) < g->W[u])
             local_search_add_vertex(g, ls, u);
     }
 }
 
+// Recompute adjacent_weight and tightness per vertex, leaving out the hubs
+static void local_search_recompute(graph *g, local_search *ls)
+{
+    ls->hub_active = 0;
+    if (ls->hubs != NULL)
+        for (int i = 0; i < ls->hubs->k; i++)
+            if (ls->independent_set[ls->hubs->H[i]])
+                ls->hub_active |= 1ull << i;
+
+    for (int u = 0; u < g->n; u++)
+    {
+        ls->adjacent_weight[u] = 0;
+        ls->tightness[u] = 0;
+        for (long long i = g->V[u]; i < g->V[u + 1]; i++)
+        {
+            int v = g->E[i];
+            if (ls->independent_set[v] && !local_search_is_hub(ls, v))
+            {
+                ls->adjacent_weight[u] += local_search_neighbor_weight(g, ls, i);
+                ls->tightness[u]++;
+            }
+        }
+    }
+}
+
+void local_search_set_cliques(graph *g, local_search *ls, const graph_cliques *K)
+{
+    if (K != NULL && ls->hubs != NULL)
+    {
+        free(ls->hub_cursor);
+        ls->hub_cursor = NULL;
+        ls->hubs = NULL;
+    }
+
+    free(ls->occupant);
+    free(ls->clique_mask);
+    ls->occupant = NULL;
+    ls->clique_mask = NULL;
+    ls->cliques = K;
+
+    if (K != NULL)
+    {
+        ls->occupant = malloc(sizeof(int) * (K->k + 1));
+        ls->clique_mask = calloc(K->k + 1, sizeof(int));
+        for (int c = 0; c < K->k; c++)
+            ls->occupant[c] = -1;
+        for (int u = 0; u < g->n; u++)
+            if (ls->independent_set[u])
+                for (long long i = K->V[u]; i < K->V[u + 1]; i++)
+                    ls->occupant[K->E[i]] = u;
+        return;
+    }
+
+    local_search_recompute(g, ls);
+}
+
+void local_search_set_hubs(graph *g, local_search *ls, const graph_hubs *H)
+{
+    free(ls->hub_cursor);
+    ls->hub_cursor = NULL;
+    ls->hubs = ls->cliques == NULL ? H : NULL;
+    ls->hub_locked = 0;
+
+    if (ls->hubs != NULL)
+        ls->hub_cursor = calloc(H->k, sizeof(long long));
+
+    if (ls->cliques == NULL)
+        local_search_recompute(g, ls);
+}
+
+// Queue the next HUB_QUEUE neighbors of hub h, instead of all of them
+static void local_search_queue_hub(graph *g, local_search *ls, int h)
+{
+    int u = ls->hubs->H[h];
+    long long degree = g->V[u + 1] - g->V[u], *cursor = ls->hub_cursor + h;
+    for (long long i = 0; i < HUB_QUEUE && i < degree; i++)
+    {
+        int v = g->E[g->V[u] + *cursor];
+        if (++*cursor == degree)
+            *cursor = 0;
+
+        if (!ls->in_queue[v] && !local_search_tabu(ls, v))
+        {
+            ls->in_queue[v] = 1;
+            ls->queue[ls->queue_count] = v;
+            ls->queue_count++;
+        }
+    }
+    ls->work += degree < HUB_QUEUE ? degree : HUB_QUEUE;
+}
+
 void local_search_add_vertex(graph *g, local_search *ls, int u)
 {
-    assert(!ls->independent_set[u] && !ls->tabu[u]);
+    assert(!ls->independent_set[u] && !local_search_tabu(ls, u));
+
+    const graph_cliques *K = ls->cliques;
 
     ls->independent_set[u] = 1;
     ls->cost += g->W[u];
@@ -124,6 +644,38 @@ void local_search_add_vertex(graph *g, local_search *ls, int u)
         ls->queue_count++;
     }
 
+    if (local_search_is_hub(ls, u))
+    {
+        // The neighbors are not updated, only the hubs next to u and the
+        // tightness[u] other neighbors in the solution are removed
+        for (uint64_t X = ls->hubs->mask[u] & ls->hub_active; X; X &= X - 1)
+            local_search_remove_vertex(g, ls, ls->hubs->H[__builtin_ctzll(X)]);
+
+        long long i = g->V[u];
+        for (; i < g->V[u + 1] && ls->tightness[u] > 0; i++)
+            if (ls->independent_set[g->E[i]])
+                local_search_remove_vertex(g, ls, g->E[i]);
+
+        ls->hub_active |= 1ull << ls->hubs->index[u];
+        ls->work += i - g->V[u] + 1;
+        return;
+    }
+
+    ls->work += K != NULL ? K->V[u + 1] - K->V[u] : g->V[u + 1] - g->V[u];
+
+    if (K != NULL)
+    {
+        // Each neighbor in the solution occupies the one clique it shares with u
+        for (long long i = K->V[u]; i < K->V[u + 1]; i++)
+        {
+            int v = ls->occupant[K->E[i]];
+            if (v >= 0)
+                local_search_remove_vertex(g, ls, v);
+            ls->occupant[K->E[i]] = u;
+        }
+        return;
+    }
+
     for (long long i = g->V[u]; i < g->V[u + 1]; i++)
     {
         int v = g->E[i];
@@ -137,7 +689,7 @@ void local_search_add_vertex(graph *g, local_search *ls, int u)
 
 void local_search_remove_vertex(graph *g, local_search *ls, int u)
 {
-    assert(ls->independent_set[u] && !ls->tabu[u]);
+    assert(ls->independent_set[u] && !local_search_tabu(ls, u));
 
     if (ls->log_enabled)
     {
@@ -160,13 +712,33 @@ void local_search_remove_vertex(graph *g, local_search *ls, int u)
         ls->queue_count++;
     }
 
+    if (local_search_is_hub(ls, u))
+    {
+        ls->hub_active &= ~(1ull << ls->hubs->index[u]);
+        local_search_queue_hub(g, ls, ls->hubs->index[u]);
+        return;
+    }
+
+    ls->work += g->V[u + 1] - g->V[u];
+
+    const graph_cliques *K = ls->cliques;
+    if (K != NULL)
+    {
+        for (long long i = K->V[u]; i < K->V[u + 1]; i++)
+            ls->occupant[K->E[i]] = -1;
+        ls->work += K->V[u + 1] - K->V[u];
+    }
+
     for (long long i = g->V[u]; i < g->V[u + 1]; i++)
     {
         int v = g->E[i];
-        ls->adjacent_weight[v] -= g->W[u];
-        ls->tightness[v]--;
+        if (K == NULL)
+        {
+            ls->adjacent_weight[v] -= g->W[u];
+            ls->tightness[v]--;
+        }
 
-        if (!ls->in_queue[v] && !ls->tabu[v])
+        if (!ls->in_queue[v] && !local_search_tabu(ls, v))
         {
             ls->in_queue[v] = 1;
             ls->queue[ls->queue_count] = v;
@@ -178,8 +750,13 @@ void local_search_remove_vertex(graph *g, local_search *ls, int u)
 void local_search_lock_vertex(graph *g, local_search *ls, int u)
 {
     ls->tabu[u]++;
-    if (ls->independent_set[u])
+    if (ls->independent_set[u] && local_search_is_hub(ls, u))
     {
+        ls->hub_locked |= 1ull << ls->hubs->index[u];
+    }
+    else if (ls->independent_set[u])
+    {
+        ls->work += g->V[u + 1] - g->V[u];
         for (long long i = g->V[u]; i < g->V[u + 1]; i++)
             ls->tabu[g->E[i]]++;
     }
@@ -188,7 +765,7 @@ void local_search_lock_vertex(graph *g, local_search *ls, int u)
 void local_search_unlock_vertex(graph *g, local_search *ls, int u)
 {
     ls->tabu[u]--;
-    if (!ls->in_queue[u] && !ls->tabu[u])
+    if (!ls->in_queue[u] && !local_search_tabu(ls, u))
     {
         ls->in_queue[u] = 1;
         ls->queue[ls->queue_count] = u;
@@ -197,12 +774,20 @@ void local_search_unlock_vertex(graph *g, local_search *ls, int u)
     if (!ls->independent_set[u])
         return;
 
+    if (local_search_is_hub(ls, u))
+    {
+        ls->hub_locked &= ~(1ull << ls->hubs->index[u]);
+        local_search_queue_hub(g, ls, ls->hubs->index[u]);
+        return;
+    }
+
+    ls->work += g->V[u + 1] - g->V[u];
     for (long long i = g->V[u]; i < g->V[u + 1]; i++)
     {
         int v = g->E[i];
         ls->tabu[v]--;
 
-        if (!ls->in_queue[v] && !ls->tabu[v])
+        if (!ls->in_queue[v] && !local_search_tabu(ls, v))
         {
             ls->in_queue[v] = 1;
             ls->queue[ls->queue_count] = v;
@@ -211,15 +796,131 @@ void local_search_unlock_vertex(graph *g, local_search *ls, int u)
     }
 }
 
-void local_search_two_one(graph *g, local_search *ls, int u)
+// Same as local_search_two_one, but two vertices are adjacent if they share a clique.
+// Neighbors sharing the same clique with u are adjacent, so only pairs from different cliques of u are tested
+static void local_search_two_one_cliques(graph *g, local_search *ls, int u)
 {
-    assert(ls->independent_set[u] && !ls->tabu[u]);
+    const graph_cliques *K = ls->cliques;
+    int *mark = ls->clique_mask;
+
+    for (long long i = K->V[u]; i < K->V[u + 1]; i++)
+        mark[K->E[i]] = i - K->V[u] + 1;
 
+    // Neighbors with u as their only neighbor in the solution, and the clique they share with u
     int adjacent_count = 0;
+    ls->work += g->V[u + 1] - g->V[u];
     for (long long i = g->V[u]; i < g->V[u + 1]; i++)
     {
-        if (ls->tightness[g->E[i]] == 1 && !ls->tabu[g->E[i]])
-            ls->temp[adjacent_count++] = g->E[i];
+        int v = g->E[i], tightness = 0, shared = 0;
+        if (local_search_tabu(ls, v))
+            continue;
+
+        ls->work += K->V[v + 1] - K->V[v];
+        for (long long j = K->V[v]; j < K->V[v + 1]; j++)
+        {
+            int x = ls->occupant[K->E[j]];
+            tightness += x >= 0 && x != v;
+            if (mark[K->E[j]])
+                shared = mark[K->E[j]];
+        }
+
+        if (tightness == 1)
+        {
+            ls->temp[adjacent_count] = v;
+            ls->temp[(long long)g->n + adjacent_count++] = shared;
+        }
+    }
+
+    for (long long i = K->V[u]; i < K->V[u + 1]; i++)
+        mark[K->E[i]] = 0;
+
+    int b1 = -1, b2 = -1;
+    long long best = LLONG_MIN;
+    for (int i = 0; i < adjacent_count; i++)
+    {
+        int v = ls->temp[i], shared = ls->temp[(long long)g->n + i];
+        for (long long j = K->V[v]; j < K->V[v + 1]; j++)
+            mark[K->E[j]] = 1;
+
+        for (int l = i + 1; l < adjacent_count; l++)
+        {
+            int w = ls->temp[l];
+            if (ls->temp[(long long)g->n + l] == shared || g->W[v] + g->W[w] <= g->W[u])
+                continue;
+
+            int adjacent = 0;
+            ls->work += K->V[w + 1] - K->V[w];
+            for (long long j = K->V[w]; j < K->V[w + 1] && !adjacent; j++)
+                adjacent = mark[K->E[j]];
+            if (adjacent)
+                continue;
+
+            long long gain = (my_rand_r(&ls->seed) % (1 << 30)) - (1 << 29);
+            long long diff = (g->W[v] + g->W[w]) - g->W[u];
+
+            if (diff + gain > best)
+            {
+                best = diff + gain;
+                b1 = v;
+                b2 = w;
+            }
+        }
+
+        for (long long j = K->V[v]; j < K->V[v + 1]; j++)
+            mark[K->E[j]] = 0;
+    }
+    if (b1 >= 0)
+    {
+        local_search_add_vertex(g, ls, b1);
+        local_search_add_vertex(g, ls, b2);
+    }
+}
+
+void local_search_two_one(graph *g, local_search *ls, int u)
+{
+    assert(ls->independent_set[u] && !local_search_tabu(ls, u));
+
+    if (ls->cliques != NULL)
+    {
+        local_search_two_one_cliques(g, ls, u);
+        return;
+    }
+
+    // The candidates are listed in temp, and their offsets in the adjacency of u in temp + n,
+    // so their weights are read from the interleaved adjacency when there is one
+    int adjacent_count = 0, *offset = ls->temp + g->n;
+    long long wu = g->W[u];
+    ls->work += g->V[u + 1] - g->V[u];
+
+    const graph_neighbor *N = ls->neighbors;
+    if (N != NULL)
+    {
+        // A neighbor lighter than W[u] minus the heaviest neighbor is in no swap,
+        // and is skipped without loading its state
+        long long heaviest = 0;
+        for (long long i = g->V[u]; i < g->V[u + 1]; i++)
+            heaviest = N[i].w > heaviest ? N[i].w : heaviest;
+
+        for (long long i = g->V[u]; i < g->V[u + 1]; i++)
+        {
+            if (N[i].w + heaviest > wu && !local_search_tabu(ls, N[i].v) &&
+                local_search_tightness(ls, N[i].v) == 1)
+            {
+                offset[adjacent_count] = i - g->V[u];
+                ls->temp[adjacent_count++] = N[i].v;
+            }
+        }
+    }
+    else
+    {
+        for (long long i = g->V[u]; i < g->V[u + 1]; i++)
+        {
+            if (!local_search_tabu(ls, g->E[i]) && local_search_tightness(ls, g->E[i]) == 1)
+            {
+                offset[adjacent_count] = i - g->V[u];
+                ls->temp[adjacent_count++] = g->E[i];
+            }
+        }
     }
 
     if (adjacent_count < 2)
@@ -230,6 +931,8 @@ void local_search_two_one(graph *g, local_search *ls, int u)
     for (int i = 0; i < adjacent_count; i++)
     {
         int v = ls->temp[i];
+        long long wv = local_search_neighbor_weight(g, ls, g->V[u] + offset[i]);
+        ls->work += g->V[v + 1] - g->V[v];
 
         int i1 = 0;
         long long i2 = g->V[v];
@@ -244,12 +947,13 @@ void local_search_two_one(graph *g, local_search *ls, int u)
                 i1++;
             else // (w1 < w2) Found 2-1 swap
             {
+                long long w = local_search_neighbor_weight(g, ls, g->V[u] + offset[i1]);
                 i1++;
-                if (g->W[w1] + g->W[v] <= g->W[u])
+                if (w + wv <= wu)
                     continue;
 
                 long long gain = (my_rand_r(&ls->seed) % (1 << 30)) - (1 << 29);
-                long long diff = (g->W[w1] + g->W[v]) - g->W[u];
+                long long diff = (w + wv) - wu;
 
                 if (diff + gain > best)
                 {
@@ -269,7 +973,7 @@ void local_search_two_one(graph *g, local_search *ls, int u)
 
 void local_search_aap(graph *g, local_search *ls, int u, int imp)
 {
-    assert(ls->independent_set[u] || ls->tightness[u] == 1);
+    assert(ls->independent_set[u] || local_search_tightness(ls, u) == 1);
 
     int current = -1, candidate_size = 0;
     ls->temp[candidate_size++] = u;
@@ -291,26 +995,33 @@ void local_search_aap(graph *g, local_search *ls, int u, int imp)
             }
         }
 
-        if (current < 0 || ls->tabu[current])
+        if (current < 0 || local_search_tabu(ls, current))
             return;
         ls->mask[u] = 1;
     }
     ls->mask[current] = 2;
 
-    int found = 1;
+    int found = 1, steps = 0;
     while (found)
     {
+        // Long paths are cut short at the deadline, the best prefix is still applied
+        if ((++steps & ((1 << 8) - 1)) == 0 && local_search_stopped(ls))
+            break;
+
         found = 0;
         long long best = INT_MIN;
         int to_add, to_remove;
+        ls->work += g->V[current + 1] - g->V[current];
 
         for (long long i = g->V[current]; i < g->V[current + 1]; i++)
         {
             int v = g->E[i];
-            if (ls->tightness[v] > 2 || ls->mask[v] == 1 || ls->tabu[v] || g->W[v] < 1)
+            long long wv = local_search_neighbor_weight(g, ls, i), wn = g->W[current];
+            if (wv < 1 || ls->mask[v] == 1 || local_search_tabu(ls, v) || local_search_tightness(ls, v) > 2)
                 continue;
 
             int valid = 1, next = current;
+            ls->work += g->V[v + 1] - g->V[v];
 
             for (long long j = g->V[v]; j < g->V[v + 1] && valid; j++)
             {
@@ -321,20 +1032,23 @@ void local_search_aap(graph *g, local_search *ls, int u, int imp)
                 if (ls->mask[w] == 1)
                     valid = 0;
                 else if (ls->independent_set[w])
+                {
                     next = w;
+                    wn = local_search_neighbor_weight(g, ls, j);
+                }
             }
 
             long long gain;
             if (!imp)
                 gain = (my_rand_r(&ls->seed) % (1 << 30)) - (1 << 29);
             else
-                gain = (my_rand_r(&ls->seed) % (2 * g->W[v])) - (g->W[v]);
+                gain = (my_rand_r(&ls->seed) % (2 * wv)) - wv;
 
-            long long change = g->W[v];
+            long long change = wv;
             if (next >= 0 && ls->mask[next] != 2)
-                change -= g->W[next];
+                change -= wn;
 
-            if (valid && !ls->tabu[next] && change + gain > best)
+            if (valid && !local_search_tabu(ls, next) && change + gain > best)
             {
                 to_add = v;
                 to_remove = next;
@@ -406,36 +1120,55 @@ static inline void local_search_swap(int **a, int **b)
 
 void local_search_greedy(graph *g, local_search *ls)
 {
-    local_search_shuffle(ls->queue, ls->queue_count, &ls->seed);
-
-    int n = ls->queue_count;
-    ls->queue_count = 0;
-    while (n > 0)
+    // Continue where an earlier call stopped, then take rounds from the queue
+    int i = ls->prev_queue_start, n = ls->prev_queue_count;
+    ls->prev_queue_start = 0;
+    ls->prev_queue_count = 0;
+    while (i < n || ls->queue_count > 0)
     {
-        local_search_swap(&ls->queue, &ls->prev_queue);
-        local_search_swap(&ls->in_queue, &ls->in_prev_queue);
+        if (i == n)
+        {
+            local_search_swap(&ls->queue, &ls->prev_queue);
+            local_search_swap(&ls->in_queue, &ls->in_prev_queue);
 
-        for (int i = 0; i < n; i++)
+            i = 0;
+            n = ls->queue_count;
+            ls->queue_count = 0;
+        }
+
+        for (; i < n; i++)
         {
+            if ((i & ((1 << 10) - 1)) == 0)
+            {
+                // The rest stays in prev_queue, a round is shuffled only once it starts
+                if (local_search_stopped(ls))
+                {
+                    ls->prev_queue_start = i;
+                    ls->prev_queue_count = n;
+                    return;
+                }
+                if (i == 0)
+                    local_search_shuffle(ls->prev_queue, n, &ls->seed);
+            }
+
+            if (i + PREFETCH_DISTANCE < n)
+                local_search_prefetch(g, ls, ls->prev_queue[i + PREFETCH_DISTANCE]);
+
             int u = ls->prev_queue[i];
             ls->in_prev_queue[u] = 0;
+            ls->work++;
 
-            if (ls->tabu[u])
+            if (local_search_tabu(ls, u))
                 continue;
 
-            if (!ls->independent_set[u] && ls->adjacent_weight[u] < g->W[u])
+            if (!ls->independent_set[u] && local_search_adjacent_weight(g, ls, u) < g->W[u])
                 local_search_add_vertex(g, ls, u);
-            else if (ls->independent_set[u] && g->V[u + 1] - g->V[u] < MAX_TWO_ONE_DEGREE)
+            else if (ls->independent_set[u] && (ls->cliques != NULL || g->V[u + 1] - g->V[u] < MAX_TWO_ONE_DEGREE))
                 local_search_two_one(g, ls, u);
 
-            if (ls->tightness[u] == 1 && g->m < AAP_LIMIT)
+            if (g->m < AAP_LIMIT && local_search_tightness(ls, u) == 1)
                 local_search_aap(g, ls, u, 1);
         }
-
-        local_search_shuffle(ls->queue, ls->queue_count, &ls->seed);
-
-        n = ls->queue_count;
-        ls->queue_count = 0;
     }
 }
 
@@ -443,17 +1176,17 @@ void local_search_perturbe(graph *g, local_search *ls)
 {
     int u = my_rand_r(&ls->seed) % g->n;
     int q = 0;
-    while (q++ < MAX_GUESS && ls->tabu[u])
+    while (q++ < MAX_GUESS && local_search_tabu(ls, u))
         u = my_rand_r(&ls->seed) % g->n;
 
-    if (ls->tabu[u])
+    if (local_search_tabu(ls, u))
         return;
 
     long long best = ls->cost;
 
-    if (g->m < AAP_LIMIT && (ls->independent_set[u] || ls->tightness[u] == 1))
+    if (g->m < AAP_LIMIT && (ls->independent_set[u] || local_search_tightness(ls, u) == 1))
     {
-        local_search_aap(g, ls, u, ls->tightness[u] == 1);
+        local_search_aap(g, ls, u, local_search_tightness(ls, u) == 1);
     }
     else
     {
@@ -472,10 +1205,10 @@ void local_search_perturbe(graph *g, local_search *ls)
         {
             int v = ls->queue[my_rand_r(&ls->seed) % ls->queue_count];
             q = 0;
-            while (q++ < MAX_GUESS && ls->tabu[v])
+            while (q++ < MAX_GUESS && local_search_tabu(ls, v))
                 v = ls->queue[my_rand_r(&ls->seed) % ls->queue_count];
 
-            if (ls->tabu[v])
+            if (local_search_tabu(ls, v))
                 continue;
 
             if (ls->independent_set[v])
@@ -488,13 +1221,18 @@ void local_search_perturbe(graph *g, local_search *ls)
     }
 }
 
-void local_search_explore(graph *g, local_search *ls, double tl, long long il, int verbose)
+void local_search_explore_begin(graph *g, local_search *ls, local_search_run *r, double tl, long long il, int verbose)
 {
-    long long best = ls->cost, c = 0;
+    r->best = ls->cost;
+    r->c = 0;
+    r->il = il;
+    r->verbose = verbose;
 
     if (verbose)
     {
-        if (il < LLONG_MAX)
+        if (ls->work_limit < LLONG_MAX)
+            printf("Running baseline local search for %.2lf seconds or %lld work units\n", tl, ls->work_limit);
+        else if (il < LLONG_MAX)
             printf("Running baseline local search for %.2lf seconds or %lld iterations\n", tl, il);
         else
             printf("Running baseline local search for %.2lf seconds\n", tl);
@@ -504,16 +1242,22 @@ void local_search_explore(graph *g, local_search *ls, double tl, long long il, i
     }
 
     double start = omp_get_wtime();
+    r->work_start = ls->work;
+
+    r->deadline = ls->deadline;
+    if (start + tl < ls->deadline)
+        ls->deadline = start + tl;
 
     ls->log_enabled = 0;
     if (ls->cost == 0)
         local_search_in_order_solution(g, ls);
     local_search_greedy(g, ls);
 
-    if (ls->cost > best)
+    if (ls->cost > r->best)
     {
-        best = ls->cost;
+        r->best = ls->cost;
         ls->time = omp_get_wtime() - ls->time_ref;
+        local_search_report(ls);
         if (verbose)
         {
             printf("\r%10lld: %12lld %8.2lf", 0ll, ls->cost, ls->time);
@@ -521,48 +1265,103 @@ void local_search_explore(graph *g, local_search *ls, double tl, long long il, i
         }
     }
 
-    while (c < il)
-    {
-        if ((c++ & ((1 << 7) - 1)) == 0)
-        {
-            // c = 0;
-            if (omp_get_wtime() - start > tl)
-                break;
+    r->improved = omp_get_wtime();
+    r->improved_it = 0;
+    r->stage = 0;
+}
 
-            if (verbose)
-            {
-                printf("\r%10lld: %12lld %8.2lf", c, ls->cost, ls->time);
-                fflush(stdout);
-            }
-        }
+int local_search_explore_step(graph *g, local_search *ls, local_search_run *r)
+{
+    if (r->c >= r->il || ls->work - r->work_start >= ls->work_limit || ls->cost >= ls->stop_weight ||
+        r->c - r->improved_it >= ls->stall_iterations)
+        return 0;
 
-        ls->log_count = 0;
-        ls->log_enabled = 1;
+    if ((r->c & ((1 << 3) - 1)) == 0 &&
+        (local_search_stopped(ls) || (ls->stall_time < INFINITY && omp_get_wtime() - r->improved >= ls->stall_time)))
+        return 0;
 
-        local_search_perturbe(g, ls);
+    if ((r->c++ & ((1 << 7) - 1)) == 0 && r->verbose)
+    {
+        printf("\r%10lld: %12lld %8.2lf", r->c, ls->cost, ls->time);
+        fflush(stdout);
+    }
 
-        local_search_greedy(g, ls);
+    ls->log_count = 0;
+    ls->log_enabled = 1;
 
-        if (ls->cost > best)
-        {
-            best = ls->cost;
-            ls->time = omp_get_wtime() - ls->time_ref;
-            ls->log_count = 0;
-            if (verbose)
-            {
-                printf("\r%10lld: %12lld %8.2lf", c, ls->cost, ls->time);
-                fflush(stdout);
-            }
-        }
-        if (ls->cost < best)
+    local_search_perturbe(g, ls);
+
+    local_search_greedy(g, ls);
+
+    if (ls->cost > r->best)
+    {
+        r->best = ls->cost;
+        ls->time = omp_get_wtime() - ls->time_ref;
+        r->improved = ls->time + ls->time_ref;
+        r->improved_it = r->c;
+        ls->log_count = 0;
+        local_search_report(ls);
+        if (r->verbose)
         {
-            local_search_unwind(g, ls, 0);
+            printf("\r%10lld: %12lld %8.2lf", r->c, ls->cost, ls->time);
+            fflush(stdout);
         }
     }
-    if (verbose)
+    if (ls->cost < r->best)
+    {
+        local_search_unwind(g, ls, 0);
+    }
+
+    r->stage = 0;
+    return 1;
+}
+
+void local_search_explore_end(local_search *ls, local_search_run *r)
+{
+    ls->deadline = r->deadline;
+    ls->stalled = r->c - r->improved_it;
+
+    if (r->verbose)
         printf("\n");
 }
 
+void local_search_explore(graph *g, local_search *ls, double tl, long long il, int verbose)
+{
+    local_search_run r;
+
+    local_search_explore_begin(g, ls, &r, tl, il, verbose);
+    while (local_search_explore_step(g, ls, &r))
+        ;
+    local_search_explore_end(ls, &r);
+}
+
+void local_search_prefetch_step(graph *g, local_search *ls, local_search_run *r)
+{
+    if (r->stage == 0)
+    {
+        // The first vertex local_search_perturbe draws, without advancing the seed
+        unsigned int seed = ls->seed;
+        r->next = my_rand_r(&seed) % g->n;
+        local_search_prefetch(g, ls, r->next);
+    }
+    else if (r->stage == 1)
+    {
+        for (long long i = g->V[r->next]; i < g->V[r->next + 1]; i += PREFETCH_LINE)
+            __builtin_prefetch(g->E + i);
+    }
+    else if (r->stage == 2)
+    {
+        long long end = g->V[r->next] + PREFETCH_NEIGHBORS;
+        for (long long i = g->V[r->next]; i < g->V[r->next + 1] && i < end; i++)
+            local_search_prefetch(g, ls, g->E[i]);
+    }
+    else
+    {
+        return;
+    }
+    r->stage++;
+}
+
 void local_search_unwind(graph *g, local_search *ls, int t)
 {
     ls->log_enabled = 0;
@@ -575,3 +1374,30 @@ void local_search_unwind(graph *g, local_search *ls, int t)
             local_search_add_vertex(g, ls, u);
     }
 }
+
+void local_search_report(local_search *ls)
+{
+    local_search_control *control = ls->control;
+    if (control == NULL || !ls->report)
+        return;
+
+    long long best;
+#pragma omp atomic read
+    best = control->best;
+
+    if (ls->cost <= best)
+        return;
+
+#pragma omp critical(local_search_report)
+    {
+        if (ls->cost > control->best)
+        {
+#pragma omp atomic write
+            control->best = ls->cost;
+            control->time = ls->time;
+
+            if (control->callback != NULL)
+                control->callback(ls->cost, ls->time, control->data);
+        }
+    }
+}
@@ -5,6 +5,7 @@
 #include <getopt.h>
 #include <dirent.h>
 #include <limits.h>
+#include <math.h>
 #include <time.h>
 #include <omp.h>
 #include <sys/stat.h>
@@ -12,6 +13,7 @@
 #include "graph.h"
 #include "local_search.h"
 #include "chils_internal.h"
+#include "components.h"
 
 long long mwis_validate(graph *g, int *independent_set)
 {
@@ -99,6 +101,18 @@ void mwis_populate_solutions(graph *g, chils *c, const char *dir_path, int verbo
     closedir(dir);
 }
 
+// Shorten the time limits by the time spent since the program started
+static void mwis_remaining_time(double program_start, double *timeout, double *t10, double *t50, double *t100)
+{
+    *timeout -= omp_get_wtime() - program_start;
+    if (*timeout < 0.0)
+        *timeout = 0.0;
+
+    *t10 = *timeout * 0.1;
+    *t50 = *timeout * 0.4;
+    *t100 = *timeout * 0.5;
+}
+
 const char *help = "CHILS --- Concurrent Hybrid Iterated Local Search\n"
                    "\nThe output of the program without -v or -b is a single line on the form:\n"
                    "instance_name,#vertices,#edges,is_weight,solution_time,total_time\n"
@@ -113,31 +127,61 @@ const char *help = "CHILS --- Concurrent Hybrid Iterated Local Search\n"
                    "-o path \tPath to store the best solution found \t\t default not stored\n"
                    "-p N \t\tRun CHILS with N concurrent solutions \t\t default 16\n"
                    "-t sec \t\tTimeout in seconds \t\t\t\t default 3600 seconds\n"
+                   "-T \t\tInclude reading the input and setup in the timeout\n"
+                   "-F \t\tFast start, all threads build one solution shared by the pool\n"
+                   "-C \t\tSolve each connected component on its own,\n\t\tnot combined with -b, -i, -f, -k, -R, -N, -w, -X, -S, -I, -Q, -H or -L\n"
+                   "-Q \t\tTrack the solution per clique in dense graphs made of large cliques\n"
+                   "-H deg \tHandle up to 64 vertices with at least deg neighbors as hubs,\n\t\twith lazy updates to their neighbors, not combined with -Q\n"
+                   "-M k \t\tRun k CHILS searches together on each thread \t default 1\n\t\tone perturbation of each in turn, to overlap memory latency\n"
+                   "-L \t\tStore the neighbor weights next to the adjacency, uses 8 more\n\t\tbytes per edge and needs weights that fit in 32 bits\n"
                    "-s sec \t\tAlternating interval for CHILS \t\t\t default 10 seconds\n"
+                   "-a \t\tAdapt the CHILS interval to observed improvements\n"
                    "-q N \t\tMax queue size after perturbe \t\t\t default 32\n"
                    "-c T \t\tSet a specific number of threads  \t\t default OMP_NUM_THREADS\n"
                    "-r s \t\tSet a specific random seed \t\t\t default time(NULL)\n"
+                   "-d D \t\tMax recursion depth for CHILS on the D-core \t default 0\n"
+                   "-D N \t\tMin D-core size before recursing \t\t default 65536\n"
+                   "-k path \tPath to periodically store CHILS checkpoints \t default not stored\n"
+                   "-K sec \t\tInterval between checkpoints \t\t\t default 60 seconds\n"
+                   "-R path \tResume CHILS from a checkpoint\n"
+                   "-N addr \tExchange solutions with other CHILS processes\n\t\tusing unix:/path/to/socket or tcp:host:port\n"
+                   "-j r \t\tRank of this process, 0 coordinates \t\t default 0\n"
+                   "-J P \t\tNumber of CHILS processes \t\t\t default 1\n"
                    "\n"
                    "-n it \t\tMax CHILS iterations \t\t\t\t default inf\n"
                    "-m it \t\tMax local search iterations \t\t\t default inf\n"
+                   "-w W \t\tMax work units, same result for any #threads \t default inf\n"
+                   "-W W \t\tWork units per solution in each CHILS interval \t default 2^28 with -w\n"
+                   "-G gap \tStop at this relative gap to the upper bound \t default 0 (optimal)\n"
+                   "-X W \t\tStop once the solution weight reaches W \t\t default inf\n"
+                   "-S sec \t\tStop after this long without improvement \t default inf\n"
+                   "-I it \t\tStop after this many iterations without improvement,\n\t\tCHILS iterations with -p > 1 \t\t\t default inf\n"
                    "\n* Mandatory input";
 
 int main(int argc, char **argv)
 {
+    double program_start = omp_get_wtime();
+
     char *graph_path = NULL,
          *initial_solution_path = NULL,
          *initial_solution_folder_path = NULL,
-         *solution_path = NULL;
+         *solution_path = NULL,
+         *checkpoint_path = NULL,
+         *resume_path = NULL,
+         *net_address = NULL;
     int verbose = 0, blocked = 0, run_chils = 16, max_queue = 32, num_threads = 0;
-    double timeout = 3600, step = 10;
+    int max_depth = 0, core_limit = 1 << 16, adaptive = 0, net_rank = 0, net_size = 1, total_time = 0;
+    int fast_start = 0, split = 0, use_cliques = 0, hub_degree = 0, interleave = 0, per_thread = 1;
+    double timeout = 3600, step = 10, checkpoint_interval = 60, gap = 0.0, stall_time = INFINITY, target_time = -1.0;
 
-    long long cl = LLONG_MAX, il = LLONG_MAX;
+    long long cl = LLONG_MAX, il = LLONG_MAX, wl = LLONG_MAX, step_work = LLONG_MAX, upper_bound = LLONG_MAX;
+    long long target = LLONG_MAX, stall_it = LLONG_MAX;
 
     unsigned int seed = time(NULL);
 
     int command;
 
-    while ((command = getopt(argc, argv, "hvbg:i:f:o:p:t:n:s:m:q:c:r:")) != -1)
+    while ((command = getopt(argc, argv, "hvbaTFCQLg:i:f:o:p:t:n:s:m:q:c:r:d:D:k:K:R:N:j:J:w:W:G:X:S:I:H:M:")) != -1)
     {
         switch (command)
         {
@@ -150,6 +194,24 @@ int main(int argc, char **argv)
         case 'b':
             blocked = 1;
             break;
+        case 'a':
+            adaptive = 1;
+            break;
+        case 'T':
+            total_time = 1;
+            break;
+        case 'F':
+            fast_start = 1;
+            break;
+        case 'C':
+            split = 1;
+            break;
+        case 'Q':
+            use_cliques = 1;
+            break;
+        case 'L':
+            interleave = 1;
+            break;
         case 'g':
             graph_path = optarg;
             break;
@@ -186,6 +248,54 @@ int main(int argc, char **argv)
         case 'r':
             seed = atoi(optarg);
             break;
+        case 'd':
+            max_depth = atoi(optarg);
+            break;
+        case 'D':
+            core_limit = atoi(optarg);
+            break;
+        case 'k':
+            checkpoint_path = optarg;
+            break;
+        case 'K':
+            checkpoint_interval = atof(optarg);
+            break;
+        case 'R':
+            resume_path = optarg;
+            break;
+        case 'N':
+            net_address = optarg;
+            break;
+        case 'j':
+            net_rank = atoi(optarg);
+            break;
+        case 'J':
+            net_size = atoi(optarg);
+            break;
+        case 'w':
+            wl = atoll(optarg);
+            break;
+        case 'W':
+            step_work = atoll(optarg);
+            break;
+        case 'G':
+            gap = atof(optarg);
+            break;
+        case 'X':
+            target = atoll(optarg);
+            break;
+        case 'S':
+            stall_time = atof(optarg);
+            break;
+        case 'I':
+            stall_it = atoll(optarg);
+            break;
+        case 'H':
+            hub_degree = atoi(optarg);
+            break;
+        case 'M':
+            per_thread = atoi(optarg);
+            break;
         case '?':
             return 1;
 
@@ -200,6 +310,30 @@ int main(int argc, char **argv)
         return 1;
     }
 
+    if (split && (blocked || initial_solution_path != NULL || initial_solution_folder_path != NULL ||
+                  checkpoint_path != NULL || resume_path != NULL || net_address != NULL || wl < LLONG_MAX ||
+                  target < LLONG_MAX || stall_time < INFINITY || stall_it < LLONG_MAX || use_cliques ||
+                  hub_degree > 0 || interleave))
+    {
+        fprintf(stderr, "Solving components with -C can not be combined with -b, -i, -f, -k, -R, -N, -w, -X, -S, -I, -Q, -H or -L\n");
+        return 1;
+    }
+
+    if (per_thread < 1 || per_thread > CHILS_MAX_INTERLEAVE)
+    {
+        fprintf(stderr, "The number of searches per thread (-M) must be between 1 and %d\n", CHILS_MAX_INTERLEAVE);
+        return 1;
+    }
+
+    if (use_cliques && hub_degree > 0)
+    {
+        fprintf(stderr, "Clique partitions (-Q) and hubs (-H) can not be combined\n");
+        return 1;
+    }
+
+    if (wl < LLONG_MAX && step_work == LLONG_MAX)
+        step_work = DEFAULT_STEP_WORK;
+
     FILE *f = fopen(graph_path, "r");
     if (f == NULL)
     {
@@ -220,7 +354,7 @@ int main(int argc, char **argv)
 
     if (initial_solution_path != NULL)
     {
-        mwis_parse_solution(g, initial_solution_path, &initial_solution_weight);
+        initial_solution = mwis_parse_solution(g, initial_solution_path, &initial_solution_weight);
     }
 
     int path_offset = 0, path_end = 0;
@@ -241,12 +375,21 @@ int main(int argc, char **argv)
         if (blocked)
             printf("Blocked mode\n");
 
+        if (split)
+            printf("Solving each connected component on its own\n");
+
         printf("Input: \t\t\t%s\n", graph_path + path_offset);
         printf("Vertices: \t\t%d\n", g->n);
         printf("Edges: \t\t\t%lld\n", g->m / 2);
         printf("Seed: \t\t\t%u\n", seed);
         if (solution_path != NULL)
             printf("Output: \t\t%s\n", solution_path);
+        if (checkpoint_path != NULL && run_chils > 1)
+            printf("Checkpoints: \t\t%s every %.2lf seconds\n", checkpoint_path, checkpoint_interval);
+        if (resume_path != NULL && run_chils > 1)
+            printf("Resume from: \t\t%s\n", resume_path);
+        if (net_address != NULL && run_chils > 1)
+            printf("Process: \t\t%d of %d using %s\n", net_rank, net_size, net_address);
         if (cl < LLONG_MAX)
             printf("Tiomeout: \t\t%.2lf seconds or %lld CHILS iterations\n", timeout, cl);
         else
@@ -258,11 +401,19 @@ int main(int argc, char **argv)
                 printf("CHILS interval: \t%.2lf seconds or %lld iterations\n", step, il);
             else
                 printf("CHILS interval: \t%.2lf seconds\n", step);
+            if (adaptive)
+                printf("Adaptive interval: \tup to %.2lf seconds\n", step * 4.0);
+            if (max_depth > 0)
+                printf("D-core recursion: \t%d levels above %d vertices\n", max_depth, core_limit);
         }
         else if (il < LLONG_MAX)
         {
             printf("LS iteration limit: \t%lld\n", il);
         }
+        if (wl < LLONG_MAX)
+            printf("Work limit: \t\t%lld units\n", wl);
+        if (run_chils > 1 && step_work < LLONG_MAX)
+            printf("CHILS work interval: \t%lld units\n", step_work);
         if (initial_solution_path != NULL)
             printf("Initial solution: \t%lld\n", initial_solution_weight);
         if (num_threads > 0)
@@ -272,16 +423,73 @@ int main(int argc, char **argv)
         printf("\n");
     }
 
+    graph_cliques *cliques = NULL;
+    if (use_cliques)
+    {
+        double clique_start = omp_get_wtime();
+        cliques = graph_clique_partition(g);
+        if (verbose && cliques != NULL)
+            printf("Clique partition: \t%d cliques, %lld memberships in %.2lf seconds\n\n",
+                   cliques->k, cliques->V[g->n], omp_get_wtime() - clique_start);
+        else if (verbose)
+            printf("Clique partition: \tnot used, too few large cliques\n\n");
+    }
+
+    graph_hubs *hubs = NULL;
+    if (hub_degree > 0)
+    {
+        hubs = graph_hubs_init(g, hub_degree);
+        if (verbose)
+            printf("Hubs: \t\t\t%d vertices with degree %d or more\n\n", hubs != NULL ? hubs->k : 0, hub_degree);
+    }
+
+    graph_neighbor *neighbors = NULL;
+    if (interleave)
+    {
+        neighbors = graph_interleave(g);
+        if (neighbors == NULL)
+            fprintf(stderr, "Interleaved adjacency not used, the weights do not fit in 32 bits\n");
+    }
+
     long long w10, w50, w100;
-    double t10 = timeout * 0.1, t50 = timeout * 0.4, t100 = timeout * 0.5, tb = 0.0, t_total = 0.0;
+    double t10 = timeout * 0.1, t50 = timeout * 0.4, t100 = timeout * 0.5, tb = 0.0, t_total = 0.0, overshoot = 0.0;
     long long c10 = cl / 10ll, c50 = (cl / 10ll) * 4, c100 = (cl / 10ll) * 5;
     long long i10 = il / 10ll, i50 = (il / 10ll) * 4, i100 = (il / 10ll) * 5;
+    long long wl10 = wl, wl50 = wl, wl100 = wl;
+    if (wl < LLONG_MAX)
+        wl10 = wl / 10ll, wl50 = (wl / 10ll) * 4, wl100 = (wl / 10ll) * 5;
 
     int *solution = malloc(sizeof(int) * g->n);
     for (int i = 0; i < g->n; i++)
         solution[i] = 0;
 
-    if (run_chils > 1)
+    if (split)
+    {
+        if (num_threads > 0)
+            omp_set_num_threads(num_threads);
+
+        components *cc = components_init(g);
+
+        components_settings s = {.p = run_chils, .max_queue = max_queue, .max_depth = max_depth,
+                                 .core_limit = core_limit, .adaptive = adaptive, .fast_start = fast_start,
+                                 .seed = seed, .step_time = step, .step_count = il};
+
+        if (total_time)
+            mwis_remaining_time(program_start, &timeout, &t10, &t50, &t100);
+
+        double start = total_time ? program_start : omp_get_wtime();
+        double deadline = omp_get_wtime() + timeout;
+
+        components_solve(g, cc, s, timeout, run_chils > 1 ? cl : il, solution, &tb, verbose);
+        w100 = mwis_validate(g, solution);
+
+        double end = omp_get_wtime();
+        t_total = end - start;
+        overshoot = end - deadline;
+
+        components_free(cc);
+    }
+    else if (run_chils > 1)
     {
         if (num_threads > 0)
             omp_set_num_threads(num_threads);
@@ -291,9 +499,39 @@ int main(int argc, char **argv)
         if (nt > run_chils)
             omp_set_num_threads(run_chils);
 
+        chils_net *net = NULL;
+        if (net_address != NULL)
+        {
+            net = chils_net_init(net_address, net_rank, net_size);
+            if (net == NULL)
+                return 1;
+
+            // Disjoint seeds for the solutions of each process
+            seed += net_rank * 2 * run_chils;
+        }
+
         chils *c = chils_init(g, run_chils, seed);
+        c->net = net;
         c->step_time = step;
         c->step_count = il;
+        c->max_depth = max_depth;
+        c->core_limit = core_limit;
+        c->adaptive = adaptive;
+        c->step_work = step_work;
+        c->work_limit = wl;
+        c->fast_start = fast_start;
+        c->searches_per_thread = per_thread;
+        c->cliques = cliques;
+        c->hubs = hubs;
+        c->neighbors = neighbors;
+        c->gap_tolerance = gap;
+        c->target_weight = target;
+        c->stall_time = stall_time;
+        c->stall_iterations = stall_it;
+
+        // Shared best solution, so all searches stop once one reaches the target
+        local_search_control control = {.stop = 0, .best = 0, .time = 0.0, .callback = NULL, .data = NULL};
+        c->control = &control;
 
         if (initial_solution != NULL)
         {
@@ -308,19 +546,43 @@ int main(int argc, char **argv)
         for (int i = 0; i < run_chils; i++)
         {
             c->LS[i]->max_queue = max_queue + (4 * i);
-            c->LS_core[i]->max_queue = max_queue + (4 * i);
         }
 
-        double start = omp_get_wtime();
+        c->checkpoint_path = checkpoint_path;
+        c->checkpoint_interval = checkpoint_interval;
+
+        if (resume_path != NULL && !chils_checkpoint_load(g, c, resume_path))
+            return 1;
+
+        if (total_time)
+            mwis_remaining_time(program_start, &timeout, &t10, &t50, &t100);
+
+        double start = total_time ? program_start : omp_get_wtime();
+        double deadline = omp_get_wtime() + timeout;
 
         if (blocked)
         {
-            chils_run(g, c, t10, c10, verbose);
-            w10 = mwis_validate(g, chils_get_best_independent_set(c));
-            chils_run(g, c, t50, c50, verbose);
-            w50 = mwis_validate(g, chils_get_best_independent_set(c));
-            chils_run(g, c, t100, c100, verbose);
-            w100 = mwis_validate(g, chils_get_best_independent_set(c));
+            // One parallel region for all three blocks, so the team stays warm
+#pragma omp parallel
+            {
+#pragma omp single
+                c->work_limit = wl10;
+                chils_run_team(g, c, t10, c10, verbose);
+#pragma omp single
+                {
+                    w10 = mwis_validate(g, chils_get_best_independent_set(c));
+                    c->work_limit = wl50;
+                }
+                chils_run_team(g, c, t50, c50, verbose);
+#pragma omp single
+                {
+                    w50 = mwis_validate(g, chils_get_best_independent_set(c));
+                    c->work_limit = wl100;
+                }
+                chils_run_team(g, c, t100, c100, verbose);
+#pragma omp single
+                w100 = mwis_validate(g, chils_get_best_independent_set(c));
+            }
         }
         else
         {
@@ -330,18 +592,26 @@ int main(int argc, char **argv)
 
         double end = omp_get_wtime();
         t_total = end - start;
+        overshoot = end - deadline;
 
         tb = c->time;
+#pragma omp atomic read
+        upper_bound = c->upper_bound;
+        target_time = c->target_time;
 
         int *best = chils_get_best_independent_set(c);
         for (int i = 0; i < g->n; i++)
             solution[i] = best[i];
 
         chils_free(c);
+        chils_net_free(net);
     }
     else
     {
         local_search *ls = local_search_init(g, seed);
+        local_search_set_cliques(g, ls, cliques);
+        local_search_set_hubs(g, ls, hubs);
+        ls->neighbors = neighbors;
 
         if (initial_solution != NULL)
             for (int u = 0; u < g->n; u++)
@@ -349,15 +619,37 @@ int main(int argc, char **argv)
                     local_search_add_vertex(g, ls, u);
 
         ls->max_queue = max_queue;
+        ls->work_limit = wl;
+        ls->stall_time = stall_time;
+        ls->stall_iterations = stall_it;
+
+        if (total_time)
+            mwis_remaining_time(program_start, &timeout, &t10, &t50, &t100);
+
+        double start = total_time ? program_start : omp_get_wtime();
+        double deadline = omp_get_wtime() + timeout;
+        ls->time_ref = start;
 
-        double start = omp_get_wtime();
+        // Only the gap tolerance needs the bound, and computing it counts against the timeout
+        if (gap > 0.0)
+        {
+            double bound_start = omp_get_wtime();
+            upper_bound = graph_clique_cover(g, NULL);
+            mwis_remaining_time(bound_start, &timeout, &t10, &t50, &t100);
+        }
+        ls->stop_weight = upper_bound - (long long)(upper_bound * gap);
+        if (target < ls->stop_weight)
+            ls->stop_weight = target;
 
         if (blocked)
         {
+            ls->work_limit = wl10;
             local_search_explore(g, ls, t10, i10, verbose);
             w10 = mwis_validate(g, ls->independent_set);
+            ls->work_limit = wl50;
             local_search_explore(g, ls, t50, i50, verbose);
             w50 = mwis_validate(g, ls->independent_set);
+            ls->work_limit = wl100;
             local_search_explore(g, ls, t100, i100, verbose);
             w100 = mwis_validate(g, ls->independent_set);
         }
@@ -369,8 +661,11 @@ int main(int argc, char **argv)
 
         double end = omp_get_wtime();
         t_total = end - start;
+        overshoot = end - deadline;
 
         tb = ls->time;
+        if (ls->cost >= ls->stop_weight)
+            target_time = ls->time;
 
         for (int i = 0; i < g->n; i++)
             solution[i] = ls->independent_set[i];
@@ -378,6 +673,15 @@ int main(int argc, char **argv)
         local_search_free(ls);
     }
 
+    if (verbose && overshoot >= 0.0)
+        printf("Stopped %.2lf ms after the deadline\n", overshoot * 1000.0);
+
+    if (verbose && upper_bound < LLONG_MAX && upper_bound > 0)
+        printf("Upper bound %lld, gap %.3lf%%\n", upper_bound, 100.0 * (upper_bound - w100) / upper_bound);
+
+    if (verbose && target_time >= 0.0)
+        printf("Reached the target after %.4lf seconds\n", target_time);
+
     if (blocked)
         printf("%s,%d,%lld,%lld,%lld,%lld,%.4lf,%.4lf\n", graph_path + path_offset,
                g->n, g->m / 2, w10, w50, w100, tb, t_total);
@@ -407,6 +711,9 @@ int main(int argc, char **argv)
 
     free(solution);
     free(initial_solution);
+    graph_cliques_free(cliques);
+    graph_hubs_free(hubs);
+    free(neighbors);
     graph_free(g);
 
     return 0;